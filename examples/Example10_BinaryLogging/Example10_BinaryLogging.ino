@@ -0,0 +1,62 @@
+/*
+  Library for the Allegro MicroSystems ACS37800 power monitor IC
+  License: please see LICENSE.md for details
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/17873
+
+  This example shows how to log the measurements as compact binary records instead of text.
+  Each record holds the raw contents of registers 0x20 - 0x22 (vrms, irms, pactive, pimag, papparent, pfactor),
+  a delta-encoded timestamp, a device id and a CRC: about 20 bytes, instead of 60 - 100 as text.
+  See SparkFun_ACS37800_Record.h for the record format.
+
+  To decode the records on a PC: compile SparkFun_ACS37800_Record.cpp (plain C++) and feed the bytes to ACS37800RecordDecoder.
+  Convert the raw register contents using the conversion factors printed (as text) at the start.
+  The decoder ignores the text. Don't print anything else once the records start.
+*/
+
+#include "SparkFun_ACS37800_Arduino_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_ACS37800
+#include <Wire.h>
+
+ACS37800 mySensor; //Create an object of the ACS37800 class
+
+ACS37800RecordEncoder encoder; // One encoder per stream
+
+const uint8_t deviceId = 1; // Identifies this sensor in the records
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("ACS37800 Example"));
+
+  Wire.begin();
+  Wire.setClock(400000);
+
+  //Initialize sensor using default I2C address
+  if (mySensor.begin() == false)
+  {
+    Serial.print(F("ACS37800 not detected. Check connections and I2C address. Freezing..."));
+    while (1)
+      ; // Do nothing more
+  }
+
+  //Print the conversion factors, so the host can convert the raw register contents
+  ACS37800_CALIBRATION_t calibration;
+  mySensor.getCalibration(&calibration);
+  Serial.print(F("voltsPerCodeRMS: "));
+  Serial.println(calibration.voltsPerCodeRMS, 9);
+  Serial.print(F("ampsPerCodeRMS: "));
+  Serial.println(calibration.ampsPerCodeRMS, 9);
+  Serial.print(F("wattsPerCode: "));
+  Serial.println(calibration.wattsPerCode, 9);
+  Serial.print(F("varPerCode: "));
+  Serial.println(calibration.varPerCode, 9);
+  Serial.print(F("vaPerCode: "));
+  Serial.println(calibration.vaPerCode, 9);
+}
+
+void loop()
+{
+  //Read 0x20 - 0x22 and write one record. Add ACS37800_RECORD_INSTANTANEOUS etc. to record more registers
+  mySensor.writeRecord(Serial, encoder, deviceId, ACS37800_RECORD_RMS | ACS37800_RECORD_POWER | ACS37800_RECORD_POWER_FACTOR);
+}
@@ -0,0 +1,78 @@
+/*
+  Library for the Allegro MicroSystems ACS37800 power monitor IC
+  License: please see LICENSE.md for details
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/17873
+
+  This example shows how to change the ACS37800 settings without blocking.
+  setNumberOfSamples and setBypassNenable wait 100ms for the shadow memory to update.
+  startSetNumberOfSamples and startSetBypassNenable return immediately. checkAsync does the work,
+  one short I2C transaction at a time, so the rest of your code keeps running.
+*/
+
+#include "SparkFun_ACS37800_Arduino_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_ACS37800
+#include <Wire.h>
+
+ACS37800 mySensor; //Create an object of the ACS37800 class
+
+int step = 0; // Which setting to change next
+
+// This is called by checkAsync when each operation completes
+void settingChanged(ACS37800ERR result, uint32_t data, void *context)
+{
+  (void)data; // Not used for the start set functions
+  Serial.print(F("Setting "));
+  Serial.print((const char *)context);
+  if (result == ACS37800_SUCCESS)
+    Serial.println(F(" changed"));
+  else
+    Serial.println(F(" failed!"));
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("ACS37800 Example"));
+
+  Wire.begin();
+
+  //mySensor.enableDebugging(); // Uncomment this line to print useful debug messages to Serial
+
+  //Initialize sensor using default I2C address
+  if (mySensor.begin() == false)
+  {
+    Serial.print(F("ACS37800 not detected. Check connections and I2C address. Freezing..."));
+    while (1)
+      ; // Do nothing more
+  }
+
+  mySensor.startSetBypassNenable(true, false, settingChanged, (void *)"bypass_n_en"); // Start setting bypass_n_en in shadow memory
+}
+
+void loop()
+{
+  // Advance the operation. This returns quickly.
+  if ((mySensor.checkAsync() == ACS37800_ASYNC_COMPLETE) && (step == 0))
+  {
+    mySensor.startSetNumberOfSamples(1023, false, settingChanged, (void *)"n"); // Start the next one
+    step++;
+  }
+
+  // Do other things here. They are not held up by the 100ms settle time.
+  static unsigned long lastPrint = 0;
+  if (millis() - lastPrint >= 250)
+  {
+    lastPrint = millis();
+    if (!mySensor.isAsyncBusy())
+    {
+      float volts = 0.0;
+      float amps = 0.0;
+      mySensor.readRMS(&volts, &amps); // Read the RMS voltage and current
+      Serial.print(F("Volts: "));
+      Serial.print(volts, 2);
+      Serial.print(F(" Amps: "));
+      Serial.println(amps, 2);
+    }
+  }
+}
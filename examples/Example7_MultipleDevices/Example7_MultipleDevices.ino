@@ -0,0 +1,90 @@
+/*
+  Library for the Allegro MicroSystems ACS37800 power monitor IC
+  License: please see LICENSE.md for details
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/17873
+
+  This example shows how to poll several ACS37800s with an ACS37800Fleet.
+  Two sensors are on Wire and two are on Wire1. Give them different addresses first - see Example2_SetI2CAddress.
+  ACS37800_FLEET_INTERLEAVE_BUSES reads them in the order Wire, Wire1, Wire, Wire1.
+  Each result carries the device index and a millis() timestamp.
+  AVR boards (Uno, Nano, Mega) have no Wire1. On those, all four sensors are on Wire, at addresses 0x60 - 0x63.
+*/
+
+#include "SparkFun_ACS37800_Arduino_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_ACS37800
+#include <Wire.h>
+
+#if defined(__AVR__)
+#define ONE_BUS // There is no Wire1
+#endif
+
+ACS37800 sensors[4]; //Create four objects of the ACS37800 class
+
+ACS37800Fleet fleet; //Create the fleet
+
+ACS37800_FLEET_RESULT_t results[ACS37800_FLEET_MAX_DEVICES]; // Storage for one polling cycle
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("ACS37800 Example"));
+
+  Wire.begin();
+#ifndef ONE_BUS
+  Wire1.begin();
+#endif
+
+  //Initialize the sensors
+  bool success = true;
+  success &= sensors[0].begin(0x60, Wire);
+  success &= sensors[1].begin(0x61, Wire);
+#ifdef ONE_BUS
+  success &= sensors[2].begin(0x62, Wire);
+  success &= sensors[3].begin(0x63, Wire);
+#else
+  success &= sensors[2].begin(0x60, Wire1);
+  success &= sensors[3].begin(0x61, Wire1);
+#endif
+
+  if (success == false)
+  {
+    Serial.print(F("An ACS37800 was not detected. Check connections and I2C addresses. Freezing..."));
+    while (1)
+      ; // Do nothing more
+  }
+
+  for (int i = 0; i < 4; i++)
+  {
+    sensors[i].setBypassNenable(true, false); // Enable bypass_n in shadow memory - to allow custom RMS calculations
+    fleet.addDevice(sensors[i]); // Add the sensor to the fleet
+  }
+
+  fleet.setOrder(ACS37800_FLEET_INTERLEAVE_BUSES); // Alternate between the buses (if there are two)
+}
+
+void loop()
+{
+  uint8_t count = fleet.pollCycle(results); // Read every sensor once
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    Serial.print(F("Sensor "));
+    Serial.print(results[i].device);
+    Serial.print(F(" at "));
+    Serial.print(results[i].timestamp);
+    if (results[i].error != ACS37800_SUCCESS)
+    {
+      Serial.println(F(": read failed!"));
+      continue;
+    }
+    Serial.print(F(": Volts: "));
+    Serial.print(results[i].measurements.vRMS, 2);
+    Serial.print(F(" Amps: "));
+    Serial.print(results[i].measurements.iRMS, 2);
+    Serial.print(F(" Watts: "));
+    Serial.println(results[i].measurements.pActive, 2);
+  }
+
+  delay(250);
+}
@@ -0,0 +1,149 @@
+/*
+  Library for the Allegro MicroSystems ACS37800 power monitor IC
+  License: please see LICENSE.md for details
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/17873
+
+  This example measures the cost of each of the read functions.
+  For each function it prints:
+    calls/sec : how many times the function can be called per second
+    bus bytes : the number of bytes on the I2C bus per call (address and data bytes. ACKs and start/stop not included)
+    bus us    : the time spent reading the registers (measured by calling readRegister for the same registers)
+    decode ns : the time spent converting the register contents (total time minus bus time)
+  Use it to compare bus speeds, processors and library versions.
+
+  The last three lines compare decoding a batch of instantaneous samples one at a time (count = 1 per call)
+  against a single call of the batch functions. decode ns is for the whole batch.
+*/
+
+#include "SparkFun_ACS37800_Arduino_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_ACS37800
+#include <Wire.h>
+
+ACS37800 mySensor; //Create an object of the ACS37800 class
+
+const unsigned long iterations = 500; // Number of calls per measurement
+
+const uint8_t bytesPerRegister = 7; // Address+W, register address, Address+R, 4 data bytes
+
+//Storage for the results - global so the compiler cannot optimize the calls away
+float f1, f2, f3, f4;
+bool b1, b2;
+int32_t i1, i2, i3;
+int16_t q1;
+uint32_t reg[3];
+ACS37800_REGISTER_2D_t errorFlags;
+ACS37800_MEASUREMENTS_t measurements;
+ACS37800_RAW_SNAPSHOT_t snapshot;
+ACS37800_DECODED_SNAPSHOT_t decoded;
+ACS37800_CALIBRATION_t calibration;
+
+//Batch decoding
+const uint16_t batchSize = 16;
+int16_t vCodes[batchSize], iCodes[batchSize], pCodes[batchSize];
+float volts[batchSize], amps[batchSize], watts[batchSize];
+int32_t milliVolts[batchSize], milliAmps[batchSize], milliWatts[batchSize];
+
+//The functions under test
+void callReadRMS() { mySensor.readRMS(&f1, &f2); }
+void callReadPowerActiveReactive() { mySensor.readPowerActiveReactive(&f1, &f2); }
+void callReadPowerFactor() { mySensor.readPowerFactor(&f1, &f2, &b1, &b2); }
+void callReadInstantaneous() { mySensor.readInstantaneous(&f1, &f2, &f3); }
+void callReadErrorFlags() { mySensor.readErrorFlags(&errorFlags); }
+void callReadMeasurements() { mySensor.readMeasurements(&measurements); }
+void callReadRMSInt() { mySensor.readRMSInt(&i1, &i2); }
+void callReadInstantaneousInt() { mySensor.readInstantaneousInt(&i1, &i2, &i3); }
+void callReadPowerFactorInt() { mySensor.readPowerFactorInt(&i1, &q1, &b1, &b2); }
+void callReadRaw() { mySensor.readRaw(&snapshot); }
+void callDecode() { ACS37800::decode(snapshot, calibration, &decoded); }
+void callDecodePerSample()
+{
+  for (uint16_t s = 0; s < batchSize; s++)
+    ACS37800::decodeInstantaneous(&vCodes[s], &iCodes[s], &pCodes[s], 1, calibration, &volts[s], &amps[s], &watts[s]);
+}
+void callDecodeInstantaneous() { ACS37800::decodeInstantaneous(vCodes, iCodes, pCodes, batchSize, calibration, volts, amps, watts); }
+void callDecodeInstantaneousInt() { ACS37800::decodeInstantaneousInt(vCodes, iCodes, pCodes, batchSize, calibration, milliVolts, milliAmps, milliWatts); }
+
+//The bus-only equivalents
+void busNone() { }
+void bus20() { mySensor.readRegister(&reg[0], ACS37800_REGISTER_VOLATILE_20); }
+void bus21() { mySensor.readRegister(&reg[0], ACS37800_REGISTER_VOLATILE_21); }
+void bus22() { mySensor.readRegister(&reg[0], ACS37800_REGISTER_VOLATILE_22); }
+void bus2D() { mySensor.readRegister(&reg[0], ACS37800_REGISTER_VOLATILE_2D); }
+void bus2A2C() { mySensor.readRegister(&reg[0], ACS37800_REGISTER_VOLATILE_2A); mySensor.readRegister(&reg[1], ACS37800_REGISTER_VOLATILE_2C); }
+void bus20to22() { mySensor.readRegisters(reg, ACS37800_REGISTER_VOLATILE_20, 3); }
+void busRaw() { bus20to22(); bus2A2C(); }
+
+//Return the average time per call in nanoseconds
+unsigned long timeCall(void (*function)())
+{
+  unsigned long startTime = micros();
+  for (unsigned long i = 0; i < iterations; i++)
+    function();
+  unsigned long elapsed = micros() - startTime;
+  return ((elapsed * 1000UL) / iterations);
+}
+
+//Measure and print one function
+void benchmark(const __FlashStringHelper *name, void (*function)(), void (*busOnly)(), uint8_t registers)
+{
+  unsigned long totalNs = timeCall(function);
+  unsigned long busNs = timeCall(busOnly);
+  unsigned long decodeNs = (totalNs > busNs) ? totalNs - busNs : 0;
+
+  Serial.print(name);
+  Serial.print(F(",\t"));
+  Serial.print((totalNs > 0) ? 1000000000UL / totalNs : 0);
+  Serial.print(F(",\t"));
+  Serial.print(registers * bytesPerRegister);
+  Serial.print(F(",\t"));
+  Serial.print(busNs / 1000UL);
+  Serial.print(F(",\t"));
+  Serial.println(decodeNs);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("ACS37800 Example"));
+
+  Wire.begin();
+  Wire.setClock(400000); // Try 100kHz and 400kHz
+
+  //Initialize sensor using default I2C address
+  if (mySensor.begin() == false)
+  {
+    Serial.print(F("ACS37800 not detected. Check connections and I2C address. Freezing..."));
+    while (1)
+      ; // Do nothing more
+  }
+
+  mySensor.getCalibration(&calibration);
+  mySensor.readRaw(&snapshot); // Something to decode
+  for (uint16_t s = 0; s < batchSize; s++)
+    ACS37800::unpackInstantaneous(&snapshot.reg2A, &snapshot.reg2C, 1, &vCodes[s], &iCodes[s], &pCodes[s]);
+
+  Serial.println(F("function,\tcalls/sec,\tbus bytes,\tbus us,\tdecode ns"));
+
+  benchmark(F("readRMS"), callReadRMS, bus20, 1);
+  benchmark(F("readPowerActiveReactive"), callReadPowerActiveReactive, bus21, 1);
+  benchmark(F("readPowerFactor"), callReadPowerFactor, bus22, 1);
+  benchmark(F("readInstantaneous"), callReadInstantaneous, bus2A2C, 2);
+  benchmark(F("readErrorFlags"), callReadErrorFlags, bus2D, 1);
+  benchmark(F("readMeasurements"), callReadMeasurements, bus20to22, 3);
+  benchmark(F("readRMSInt"), callReadRMSInt, bus20, 1);
+  benchmark(F("readPowerFactorInt"), callReadPowerFactorInt, bus22, 1);
+  benchmark(F("readInstantaneousInt"), callReadInstantaneousInt, bus2A2C, 2);
+  benchmark(F("readRaw"), callReadRaw, busRaw, 5);
+  benchmark(F("decode"), callDecode, busNone, 0);
+  benchmark(F("decodeInstantaneous x1 (per sample)"), callDecodePerSample, busNone, 0);
+  benchmark(F("decodeInstantaneous (batch)"), callDecodeInstantaneous, busNone, 0);
+  benchmark(F("decodeInstantaneousInt (batch)"), callDecodeInstantaneousInt, busNone, 0);
+
+  Serial.println(F("Done"));
+}
+
+void loop()
+{
+  // Nothing to do here
+}
@@ -0,0 +1,71 @@
+/*
+  Library for the Allegro MicroSystems ACS37800 power monitor IC
+  License: please see LICENSE.md for details
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/17873
+
+  This example shows how to capture the instantaneous voltage and current waveforms.
+  captureInstantaneous reads raw samples into a ring buffer as fast as the I2C bus allows.
+  The samples are converted to Volts and Amps afterwards, using the conversion factors from getCalibration.
+  Use a fast I2C clock (400kHz or more) for the best sample rate.
+  Each sample uses 12 bytes of RAM. On AVR boards (Uno, Nano: 2KB of RAM) only 64 samples are captured.
+*/
+
+#include "SparkFun_ACS37800_Arduino_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_ACS37800
+#include <Wire.h>
+
+ACS37800 mySensor; //Create an object of the ACS37800 class
+
+#if defined(__AVR__)
+const uint16_t numSamples = 64; // Leave room for everything else in 2KB of RAM
+#else
+const uint16_t numSamples = 200; // About 35ms at 400kHz: two 50/60Hz cycles
+#endif
+ACS37800_WAVEFORM_SAMPLE_t sampleStorage[numSamples]; // Storage for the ring buffer
+ACS37800WaveformBuffer waveform(sampleStorage, numSamples); // The ring buffer
+
+ACS37800_CALIBRATION_t calibration; // The conversion factors
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("ACS37800 Example"));
+
+  Wire.begin();
+  Wire.setClock(400000);
+
+  //Initialize sensor using default I2C address
+  if (mySensor.begin() == false)
+  {
+    Serial.print(F("ACS37800 not detected. Check connections and I2C address. Freezing..."));
+    while (1)
+      ; // Do nothing more
+  }
+
+  mySensor.getCalibration(&calibration); // Get the conversion factors
+}
+
+void loop()
+{
+  waveform.clear();
+
+  mySensor.captureInstantaneous(waveform, numSamples); // Capture vcodes and icodes. Add true to capture pinstant too
+
+  ACS37800_WAVEFORM_SAMPLE_t sample;
+  unsigned long firstSample = 0;
+  bool first = true;
+  while (waveform.pop(&sample))
+  {
+    if (first)
+      firstSample = sample.timestamp;
+    first = false;
+    Serial.print(sample.timestamp - firstSample); // Microseconds
+    Serial.print(F(","));
+    Serial.print((float)sample.vCodes * calibration.voltsPerCodeInst, 2); // Volts
+    Serial.print(F(","));
+    Serial.println((float)sample.iCodes * calibration.ampsPerCodeInst, 3); // Amps
+  }
+
+  delay(1000);
+}
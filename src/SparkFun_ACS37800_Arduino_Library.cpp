@@ -19,6 +19,7 @@
 //Constructor
 ACS37800::ACS37800()
 {
+  updateCalibration(); // Calculate the conversion factors for the default resistances and current range
 }
 
 //Start I2C communication using the specified port
@@ -28,6 +29,8 @@ bool ACS37800::begin(uint8_t address, TwoWire &wirePort)
   _ACS37800Address = address; //Grab which i2c address the user wants us to use
   _i2cPort = &wirePort; //Grab which port the user wants us to use
 
+  updateCalibration(); // Make sure the conversion factors are up to date
+
   // Wire.beginTransmission(address);
   // if (Wire.endTransmission() != 0) // Did we detect something?
   // {
@@ -62,8 +65,38 @@ bool ACS37800::begin(uint8_t address, TwoWire &wirePort)
 //You can also call it with other streams like Serial1, SerialUSB, etc.
 void ACS37800::enableDebugging(Stream &debugPort)
 {
+#if ACS37800_DEBUG_LEVEL > 0
 	_debugPort = &debugPort;
 	_printDebug = true;
+#else
+  (void)debugPort; // Debug printing is compiled out
+#endif
+}
+
+//Call hook (with context) whenever a register access fails. Use NULL to disable.
+void ACS37800::setErrorHook(ACS37800_ERROR_HOOK hook, void *context)
+{
+  _errorHook = hook;
+  _errorHookContext = context;
+}
+
+//Call the error hook (if any)
+void ACS37800::reportError(ACS37800ERR error, uint8_t address, uint8_t detail)
+{
+  if (_errorHook != NULL)
+    _errorHook(error, address, detail, _errorHookContext);
+}
+
+//Return the I2C port passed to begin
+TwoWire *ACS37800::getWirePort()
+{
+  return (_i2cPort);
+}
+
+//Return the I2C address passed to begin
+uint8_t ACS37800::getI2Caddress()
+{
+  return (_ACS37800Address);
 }
 
 //Read a register's contents. Contents are returned in data.
@@ -80,6 +113,7 @@ ACS37800ERR ACS37800::readRegister(uint32_t *data, uint8_t address)
       _debugPort->print(F("readRegister: endTransmission returned: "));
       _debugPort->println(i2cResult);
     }
+    reportError(ACS37800_ERR_I2C_ERROR, address, i2cResult);
     return (ACS37800_ERR_I2C_ERROR); // Bail
   }
 
@@ -92,6 +126,7 @@ ACS37800ERR ACS37800::readRegister(uint32_t *data, uint8_t address)
       _debugPort->print(F("readRegister: requestFrom returned: "));
       _debugPort->println(toRead);
     }
+    reportError(ACS37800_ERR_I2C_ERROR, address, toRead);
     return (ACS37800_ERR_I2C_ERROR); // Bail
   }
 
@@ -131,71 +166,66 @@ ACS37800ERR ACS37800::writeRegister(uint32_t data, uint8_t address)
       _debugPort->print(F("writeRegister: endTransmission returned: "));
       _debugPort->println(i2cResult);
     }
+    reportError(ACS37800_ERR_I2C_ERROR, address, i2cResult);
+    uint8_t item = configItem(address);
+    if (item < 10)
+      _cacheValid &= ~(1 << item); // The write may or may not have happened
     return (ACS37800_ERR_I2C_ERROR); // Bail
   }
 
+  updateCache(address, data, true); // Keep the cache (if enabled) in step. Dirty until read back
+
   return (ACS37800_SUCCESS);
 }
 
-//Change the I2C address
-ACS37800ERR ACS37800::setI2Caddress(uint8_t newAddress)
+//Read count consecutive registers, starting at address. Contents are returned in data[0..count-1].
+ACS37800ERR ACS37800::readRegisters(uint32_t *data, uint8_t address, uint8_t count)
 {
-  ACS37800ERR error = writeRegister(ACS37800_CUSTOMER_ACCESS_CODE, ACS37800_REGISTER_VOLATILE_2F); // Set the customer access code
-
-  if (error != ACS37800_SUCCESS)
+  for (uint8_t i = 0; i < count; i++)
   {
-    if (_printDebug == true)
-    {
-      _debugPort->print(F("setI2Caddress: writeRegister (2F) returned: "));
-      _debugPort->println(error);
-    }
-    return (error); // Bail
-  }
-
-  ACS37800_REGISTER_0F_t store;
-  error = readRegister(&store.data.all, ACS37800_REGISTER_EEPROM_0F); // Read register 0F
+    ACS37800ERR error = readRegister(&data[i], address + i);
 
-  if (error != ACS37800_SUCCESS)
-  {
-    if (_printDebug == true)
+    if (error != ACS37800_SUCCESS)
     {
-      _debugPort->print(F("setI2Caddress: readRegister (0F) returned: "));
-      _debugPort->println(error);
+      if (_printDebug == true)
+      {
+        _debugPort->print(F("readRegisters: readRegister (0x"));
+        _debugPort->print(address + i, HEX);
+        _debugPort->print(F(") returned: "));
+        _debugPort->println(error);
+      }
+      return (error); // Bail
     }
-    return (error); // Bail
   }
 
-  store.data.bits.i2c_slv_addr = newAddress & 0x7F; //Update the address
-  store.data.bits.i2c_dis_slv_addr = 1; //Disable setting the address via the DIO pins
-
-  error = writeRegister(store.data.all, ACS37800_REGISTER_EEPROM_0F); // Write register 0F
+  return (ACS37800_SUCCESS);
+}
 
-  if (error != ACS37800_SUCCESS)
-  {
-    if (_printDebug == true)
-    {
-      _debugPort->print(F("setI2Caddress: writeRegister (0F) returned: "));
-      _debugPort->println(error);
-    }
-    return (error); // Bail
-  }
+//Change the I2C address
+ACS37800ERR ACS37800::setI2Caddress(uint8_t newAddress)
+{
+  uint32_t mask = ACS37800_FIELD_I2C_SLV_ADDR::mask | ACS37800_FIELD_I2C_DIS_SLV_ADDR::mask;
+  uint32_t value = ACS37800_FIELD_I2C_SLV_ADDR::insert(0, newAddress); //Update the address
+  value = ACS37800_FIELD_I2C_DIS_SLV_ADDR::insert(value, 1); //Disable setting the address via the DIO pins
 
-  error = writeRegister(0, ACS37800_REGISTER_VOLATILE_2F); // Clear the customer access code
+  ACS37800_CONFIG_t config;
+  beginConfig(&config);
+  stageConfig(&config, ACS37800_REGISTER_EEPROM_0F, mask, value); // EEPROM only
+  ACS37800ERR error = commitConfig(&config);
 
   if (error != ACS37800_SUCCESS)
   {
     if (_printDebug == true)
     {
-      _debugPort->print(F("setI2Caddress: writeRegister (2F) returned: "));
+      _debugPort->print(F("setI2Caddress: commitConfig returned: "));
       _debugPort->println(error);
     }
     return (error); // Bail
   }
 
-  delay(100); // Allow time for the shadow/eeprom memory to be updated - otherwise the next readRegister will return zero...
-
   // Verify that the address was written correctly
-  error = readRegister(&store.data.all, ACS37800_REGISTER_EEPROM_0F); // Read register 0F
+  uint32_t store;
+  error = readRegister(&store, ACS37800_REGISTER_EEPROM_0F); // Read register 0F
 
   if (error != ACS37800_SUCCESS)
   {
@@ -207,7 +237,9 @@ ACS37800ERR ACS37800::setI2Caddress(uint8_t newAddress)
     return (error); // Bail
   }
 
-  if ((store.data.bits.i2c_slv_addr == newAddress) && (store.data.bits.ECC == ACS37800_EEPROM_ECC_NO_ERROR))
+  uint8_t address = (uint8_t)ACS37800_FIELD_I2C_SLV_ADDR::extract(store);
+  uint8_t ecc = (uint8_t)(store >> 26); // Bits 26-31
+  if ((address == newAddress) && (ecc == ACS37800_EEPROM_ECC_NO_ERROR))
   {
     return (ACS37800_SUCCESS);
   }
@@ -216,9 +248,9 @@ ACS37800ERR ACS37800::setI2Caddress(uint8_t newAddress)
     if (_printDebug == true)
     {
       _debugPort->print(F("setI2Caddress: i2c_slv_addr is 0x"));
-      _debugPort->println(store.data.bits.i2c_slv_addr, HEX);
+      _debugPort->println(address, HEX);
       _debugPort->print(F("setI2Caddress: ECC is "));
-      _debugPort->println(store.data.bits.ECC);
+      _debugPort->println(ecc);
     }
     return (ACS37800_ERR_REGISTER_READ_MODIFY_WRITE_FAILURE);
   }
@@ -229,26 +261,34 @@ ACS37800ERR ACS37800::setI2Caddress(uint8_t newAddress)
 //Set the number of samples for RMS calculations. Bypass_N_Enable must be set/true for this to have effect.
 ACS37800ERR ACS37800::setNumberOfSamples(uint32_t numberOfSamples, bool _eeprom)
 {
-  ACS37800ERR error = writeRegister(ACS37800_CUSTOMER_ACCESS_CODE, ACS37800_REGISTER_VOLATILE_2F); // Set the customer access code
+  ACS37800_CONFIG_t config;
+  beginConfig(&config);
+  stageNumberOfSamples(&config, numberOfSamples, _eeprom);
+  ACS37800ERR error = commitConfig(&config);
 
   if (error != ACS37800_SUCCESS)
   {
     if (_printDebug == true)
     {
-      _debugPort->print(F("setNumberOfSamples: writeRegister (2F) returned: "));
+      _debugPort->print(F("setNumberOfSamples: commitConfig returned: "));
       _debugPort->println(error);
     }
-    return (error); // Bail
   }
 
-  ACS37800_REGISTER_0F_t store;
-  error = readRegister(&store.data.all, ACS37800_REGISTER_SHADOW_1F); // Read register 1F
+  return (error);
+}
+
+//Read and return the number of samples from shadow memory
+ACS37800ERR ACS37800::getNumberOfSamples(uint32_t *numberOfSamples)
+{
+  int32_t n;
+  ACS37800ERR error = getField<ACS37800_FIELD_N>(&n); // Read register 1F
 
   if (error != ACS37800_SUCCESS)
   {
     if (_printDebug == true)
     {
-      _debugPort->print(F("setNumberOfSamples: readRegister (1F) returned: "));
+      _debugPort->print(F("getNumberOfSamples: readRegister (1F) returned: "));
       _debugPort->println(error);
     }
     return (error); // Bail
@@ -256,220 +296,160 @@ ACS37800ERR ACS37800::setNumberOfSamples(uint32_t numberOfSamples, bool _eeprom)
 
   if (_printDebug == true)
   {
-    _debugPort->print(F("setNumberOfSamples: number of samples is currently: "));
-    _debugPort->println(store.data.bits.n);
+    _debugPort->print(F("getNumberOfSamples: number of samples is currently: "));
+    _debugPort->println(n);
   }
 
-  store.data.bits.n = numberOfSamples & 0x3FF; //Adjust the number of samples (limit to 10 bits)
+  *numberOfSamples = n; //Return the number of samples
 
-  error = writeRegister(store.data.all, ACS37800_REGISTER_SHADOW_1F); // Write register 1F
+  return (error);
+}
+
+//Set/Clear the Bypass_N_Enable flag
+ACS37800ERR ACS37800::setBypassNenable(bool bypass, bool _eeprom)
+{
+  ACS37800_CONFIG_t config;
+  beginConfig(&config);
+  stageBypassNenable(&config, bypass, _eeprom);
+  ACS37800ERR error = commitConfig(&config);
 
   if (error != ACS37800_SUCCESS)
   {
     if (_printDebug == true)
     {
-      _debugPort->print(F("setNumberOfSamples: writeRegister (1F) returned: "));
+      _debugPort->print(F("setBypassNenable: commitConfig returned: "));
       _debugPort->println(error);
     }
-    return (error); // Bail
   }
 
-  if (_eeprom) // Check if user wants to set eeprom too
-  {
-    error = readRegister(&store.data.all, ACS37800_REGISTER_EEPROM_0F); // Read register 0F
-
-    if (error != ACS37800_SUCCESS)
-    {
-      if (_printDebug == true)
-      {
-        _debugPort->print(F("setNumberOfSamples: readRegister (0F) returned: "));
-        _debugPort->println(error);
-      }
-      return (error); // Bail
-    }
-
-    if (_printDebug == true)
-    {
-      _debugPort->print(F("setNumberOfSamples: eeprom number of samples is currently: "));
-      _debugPort->println(store.data.bits.n);
-    }
-
-    store.data.bits.n = numberOfSamples & 0x3FF; //Adjust the number of samples (limit to 10 bits)
-
-    error = writeRegister(store.data.all, ACS37800_REGISTER_EEPROM_0F); // Write register 0F
-
-    if (error != ACS37800_SUCCESS)
-    {
-      if (_printDebug == true)
-      {
-        _debugPort->print(F("setNumberOfSamples: writeRegister (0F) returned: "));
-        _debugPort->println(error);
-      }
-    }
-  }
+  return (error);
+}
 
-  error = writeRegister(0, ACS37800_REGISTER_VOLATILE_2F); // Clear the customer access code
+//Set the zero crossing channel, edge and output type
+ACS37800ERR ACS37800::setZeroCrossing(ACS37800_ZC_CHANNEL_e channel, ACS37800_ZC_EDGE_e edge, bool squareWave, bool _eeprom)
+{
+  ACS37800_CONFIG_t config;
+  beginConfig(&config);
+  stageZeroCrossing(&config, channel, edge, squareWave, _eeprom);
+  ACS37800ERR error = commitConfig(&config);
 
   if (error != ACS37800_SUCCESS)
   {
     if (_printDebug == true)
     {
-      _debugPort->print(F("setNumberOfSamples: writeRegister (2F) returned: "));
+      _debugPort->print(F("setZeroCrossing: commitConfig returned: "));
       _debugPort->println(error);
     }
-    return (error); // Bail
   }
 
-  delay(100); // Allow time for the shadow/eeprom memory to be updated - otherwise the next readRegister will return zero...
-
   return (error);
 }
 
-//Read and return the number of samples from shadow memory
-ACS37800ERR ACS37800::getNumberOfSamples(uint32_t *numberOfSamples)
+//Set the iavgselen and pavgselen flags
+ACS37800ERR ACS37800::setAverageSelect(bool iavgselen, bool pavgselen, bool _eeprom)
 {
-  ACS37800_REGISTER_0F_t store;
-  ACS37800ERR error = readRegister(&store.data.all, ACS37800_REGISTER_SHADOW_1F); // Read register 1F
+  ACS37800_CONFIG_t config;
+  beginConfig(&config);
+  stageAverageSelect(&config, iavgselen, pavgselen, _eeprom);
+  ACS37800ERR error = commitConfig(&config);
 
   if (error != ACS37800_SUCCESS)
   {
     if (_printDebug == true)
     {
-      _debugPort->print(F("getNumberOfSamples: readRegister (1F) returned: "));
+      _debugPort->print(F("setAverageSelect: commitConfig returned: "));
       _debugPort->println(error);
     }
-    return (error); // Bail
-  }
-
-  if (_printDebug == true)
-  {
-    _debugPort->print(F("getNumberOfSamples: number of samples is currently: "));
-    _debugPort->println(store.data.bits.n);
   }
 
-  *numberOfSamples = store.data.bits.n; //Return the number of samples
-
   return (error);
 }
 
-//Set/Clear the Bypass_N_Enable flag
-ACS37800ERR ACS37800::setBypassNenable(bool bypass, bool _eeprom)
+//Set rms_avg_1 and rms_avg_2
+ACS37800ERR ACS37800::setAverageCounts(uint8_t rmsAvg1, uint16_t rmsAvg2, bool _eeprom)
 {
-  ACS37800ERR error = writeRegister(ACS37800_CUSTOMER_ACCESS_CODE, ACS37800_REGISTER_VOLATILE_2F); // Set the customer access code
+  ACS37800_CONFIG_t config;
+  beginConfig(&config);
+  stageAverageCounts(&config, rmsAvg1, rmsAvg2, _eeprom);
+  ACS37800ERR error = commitConfig(&config);
 
   if (error != ACS37800_SUCCESS)
   {
     if (_printDebug == true)
     {
-      _debugPort->print(F("setBypassNenable: writeRegister (2F) returned: "));
+      _debugPort->print(F("setAverageCounts: commitConfig returned: "));
       _debugPort->println(error);
     }
-    return (error); // Bail
   }
 
-  ACS37800_REGISTER_0F_t store;
-  error = readRegister(&store.data.all, ACS37800_REGISTER_SHADOW_1F); // Read register 1F
+  return (error);
+}
+
+//Set dio_0_sel and dio_1_sel
+ACS37800ERR ACS37800::setDIOFunctions(ACS37800_DIO0_FUNC_e dio0, ACS37800_DIO1_FUNC_e dio1, bool _eeprom)
+{
+  ACS37800_CONFIG_t config;
+  beginConfig(&config);
+  stageDIOFunctions(&config, dio0, dio1, _eeprom);
+  ACS37800ERR error = commitConfig(&config);
 
   if (error != ACS37800_SUCCESS)
   {
     if (_printDebug == true)
     {
-      _debugPort->print(F("setBypassNenable: readRegister (1F) returned: "));
+      _debugPort->print(F("setDIOFunctions: commitConfig returned: "));
       _debugPort->println(error);
     }
-    return (error); // Bail
-  }
-
-  if (_printDebug == true)
-  {
-    _debugPort->print(F("setBypassNenable: bypass_n_en is currently: "));
-    _debugPort->println(store.data.bits.bypass_n_en);
   }
 
-  if (bypass) //Adjust bypass_n_en
-  {
-    store.data.bits.bypass_n_en = 1;
-  }
-  else
-  {
-    store.data.bits.bypass_n_en = 0;
-  }
+  return (error);
+}
 
-  error = writeRegister(store.data.all, ACS37800_REGISTER_SHADOW_1F); // Write register 1F
+//Set overvreg, undervreg and vevent_cycs
+ACS37800ERR ACS37800::setVoltageEvents(uint8_t overvreg, uint8_t undervreg, uint8_t veventCycles, bool _eeprom)
+{
+  ACS37800_CONFIG_t config;
+  beginConfig(&config);
+  stageVoltageEvents(&config, overvreg, undervreg, veventCycles, _eeprom);
+  ACS37800ERR error = commitConfig(&config);
 
   if (error != ACS37800_SUCCESS)
   {
     if (_printDebug == true)
     {
-      _debugPort->print(F("setBypassNenable: writeRegister (1F) returned: "));
+      _debugPort->print(F("setVoltageEvents: commitConfig returned: "));
       _debugPort->println(error);
     }
-    return (error); // Bail
   }
 
-  if (_eeprom) // Check if user wants to set eeprom too
-  {
-    error = readRegister(&store.data.all, ACS37800_REGISTER_EEPROM_0F); // Read register 0F
-
-    if (error != ACS37800_SUCCESS)
-    {
-      if (_printDebug == true)
-      {
-        _debugPort->print(F("setBypassNenable: readRegister (0F) returned: "));
-        _debugPort->println(error);
-      }
-      return (error); // Bail
-    }
-
-    if (_printDebug == true)
-    {
-      _debugPort->print(F("setBypassNenable: eeprom bypass_n_en is currently: "));
-      _debugPort->println(store.data.bits.bypass_n_en);
-    }
-
-    if (bypass) //Adjust bypass_n_en
-    {
-      store.data.bits.bypass_n_en = 1;
-    }
-    else
-    {
-      store.data.bits.bypass_n_en = 0;
-    }
-
-    error = writeRegister(store.data.all, ACS37800_REGISTER_EEPROM_0F); // Write register 0F
-
-    if (error != ACS37800_SUCCESS)
-    {
-      if (_printDebug == true)
-      {
-        _debugPort->print(F("setBypassNenable: writeRegister (0F) returned: "));
-        _debugPort->println(error);
-      }
-    }
-  }
+  return (error);
+}
 
-  error = writeRegister(0, ACS37800_REGISTER_VOLATILE_2F); // Clear the customer access code
+//Set fault and fltdly
+ACS37800ERR ACS37800::setOvercurrentFault(uint8_t fault, ACS37800_FLTDLY_e delay, bool _eeprom)
+{
+  ACS37800_CONFIG_t config;
+  beginConfig(&config);
+  stageOvercurrentFault(&config, fault, delay, _eeprom);
+  ACS37800ERR error = commitConfig(&config);
 
   if (error != ACS37800_SUCCESS)
   {
     if (_printDebug == true)
     {
-      _debugPort->print(F("setBypassNenable: writeRegister (2F) returned: "));
+      _debugPort->print(F("setOvercurrentFault: commitConfig returned: "));
       _debugPort->println(error);
     }
-    return (error); // Bail
   }
 
-  delay(100); // Allow time for the shadow/eeprom memory to be updated - otherwise the next readRegister will return zero...
-
   return (error);
 }
 
 //// Read and return the bypass_n_en flag from shadow memory
 ACS37800ERR ACS37800::getBypassNenable(bool *bypass)
 {
-  ACS37800_REGISTER_0F_t store;
-  ACS37800ERR error = readRegister(&store.data.all, ACS37800_REGISTER_SHADOW_1F); // Read register 1F
+  int32_t bypassNenable;
+  ACS37800ERR error = getField<ACS37800_FIELD_BYPASS_N_EN>(&bypassNenable); // Read register 1F
 
   if (error != ACS37800_SUCCESS)
   {
@@ -484,10 +464,10 @@ ACS37800ERR ACS37800::getBypassNenable(bool *bypass)
   if (_printDebug == true)
   {
     _debugPort->print(F("getBypassNenable: bypass_n_en is currently: "));
-    _debugPort->println(store.data.bits.bypass_n_en);
+    _debugPort->println(bypassNenable);
   }
 
-  *bypass = (bool)store.data.bits.bypass_n_en; //Return bypass_n_en
+  *bypass = (bool)bypassNenable; //Return bypass_n_en
 
   return (error);
 }
@@ -495,8 +475,8 @@ ACS37800ERR ACS37800::getBypassNenable(bool *bypass)
 //Get the coarse current gain from shadow memory
 ACS37800ERR ACS37800::getCurrentCoarseGain(float *currentCoarseGain)
 {
-  ACS37800_REGISTER_0B_t store;
-  ACS37800ERR error = readRegister(&store.data.all, ACS37800_REGISTER_SHADOW_1B); // Read register 1B
+  int32_t crsSns;
+  ACS37800ERR error = getField<ACS37800_FIELD_CRS_SNS>(&crsSns); // Read register 1B
 
   if (error != ACS37800_SUCCESS)
   {
@@ -508,7 +488,7 @@ ACS37800ERR ACS37800::getCurrentCoarseGain(float *currentCoarseGain)
     return (error); // Bail
   }
 
-  float gain = ACS37800_CRS_SNS_GAINS[store.data.bits.crs_sns];
+  float gain = ACS37800_CRS_SNS_GAINS[crsSns];
 
   if (_printDebug == true)
   {
@@ -524,8 +504,8 @@ ACS37800ERR ACS37800::getCurrentCoarseGain(float *currentCoarseGain)
 // Read volatile register 0x20. Return the vInst (Volts) and iInst (Amps).
 ACS37800ERR ACS37800::readRMS(float *vRMS, float *iRMS)
 {
-  ACS37800_REGISTER_20_t store;
-  ACS37800ERR error = readRegister(&store.data.all, ACS37800_REGISTER_VOLATILE_20); // Read register 20
+  uint32_t store;
+  ACS37800ERR error = readRegister(&store, ACS37800_REGISTER_VOLATILE_20); // Read register 20
 
   if (error != ACS37800_SUCCESS)
   {
@@ -540,21 +520,16 @@ ACS37800ERR ACS37800::readRMS(float *vRMS, float *iRMS)
   //Extract vrms. Convert to voltage in Volts.
   // Note: datasheet says "RMS voltage output. This field is an unsigned 16-bit fixed point number with 16 fractional bits"
   // Datasheet also says "Voltage Channel ADC Sensitivity: 110 LSB/mV"
-  float volts = (float)store.data.bits.vrms;
+  int32_t vrms = ACS37800_FIELD_VRMS::extract(store); // vrms is unsigned
+  float volts = (float)vrms;
   if (_printDebug == true)
   {
     _debugPort->print(F("readRMS: vrms: 0x"));
-    _debugPort->println(store.data.bits.vrms, HEX);
+    _debugPort->println(vrms, HEX);
     _debugPort->print(F("readRMS: volts (LSB, before correction) is "));
     _debugPort->println(volts);
   }
-  volts /= 55000.0; //Convert from codes to the fraction of ADC Full Scale (16-bit)
-  volts *= 250; //Convert to mV (Differential Input Range is +/- 250mV)
-  volts /= 1000; //Convert to Volts
-  //Correct for the voltage divider: (RISO1 + RISO2 + RSENSE) / RSENSE
-  //Or:  (RISO1 + RISO2 + RISO3 + RISO4 + RSENSE) / RSENSE
-  float resistorMultiplier = (_dividerResistance + _senseResistance) / _senseResistance;
-  volts *= resistorMultiplier;
+  volts *= _calibration.voltsPerCodeRMS; //Convert to Volts, correcting for the voltage divider
   if (_printDebug == true)
   {
     _debugPort->print(F("readRMS: volts (V, after correction) is "));
@@ -564,23 +539,16 @@ ACS37800ERR ACS37800::readRMS(float *vRMS, float *iRMS)
 
   //Extract the irms. Convert to current in Amps.
   //Datasheet says: "RMS current output. This field is a signed 16-bit fixed point number with 15 fractional bits"
-  union
-  {
-    int16_t Signed;
-    uint16_t unSigned;
-  } signedUnsigned; // Avoid any ambiguity when casting to signed int
-
-  signedUnsigned.unSigned = store.data.bits.irms; //Extract irms as signed int
-  float amps = (float)signedUnsigned.Signed;
+  int32_t irms = ACS37800_FIELD_IRMS::extract(store); //Extract irms as signed int
+  float amps = (float)irms;
   if (_printDebug == true)
   {
     _debugPort->print(F("readRMS: irms: 0x"));
-    _debugPort->println(store.data.bits.irms, HEX);
+    _debugPort->println((uint16_t)irms, HEX);
     _debugPort->print(F("readRMS: amps (LSB, before correction) is "));
     _debugPort->println(amps);
   }
-  amps /= 55000.0; //Convert from codes to the fraction of ADC Full Scale (16-bit)
-  amps *= _currentSensingRange; //Convert to Amps
+  amps *= _calibration.ampsPerCodeRMS; //Convert to Amps
   if (_printDebug == true)
   {
     _debugPort->print(F("readRMS: amps (A, after correction) is "));
@@ -594,8 +562,8 @@ ACS37800ERR ACS37800::readRMS(float *vRMS, float *iRMS)
 // Read volatile register 0x21. Return the pactive and pimag.
 ACS37800ERR ACS37800::readPowerActiveReactive(float *pActive, float *pReactive)
 {
-  ACS37800_REGISTER_21_t store;
-  ACS37800ERR error = readRegister(&store.data.all, ACS37800_REGISTER_VOLATILE_21); // Read register 21
+  uint32_t store;
+  ACS37800ERR error = readRegister(&store, ACS37800_REGISTER_VOLATILE_21); // Read register 21
 
   if (error != ACS37800_SUCCESS)
   {
@@ -617,30 +585,16 @@ ACS37800ERR ACS37800::readPowerActiveReactive(float *pActive, float *pReactive)
   // Datasheet also says:
   //  "3.08 LSB/mW for the 30A version and 1.03 LSB/mW for the 90A version"
 
-  union
-  {
-    int16_t Signed;
-    uint16_t unSigned;
-  } signedUnsigned; // Avoid any ambiguity when casting to signed int
-
-  signedUnsigned.unSigned = store.data.bits.pactive;
-
-  float power = (float)signedUnsigned.Signed;
+  int32_t pactive = ACS37800_FIELD_PACTIVE::extract(store); //Extract pactive as signed int
+  float power = (float)pactive;
   if (_printDebug == true)
   {
     _debugPort->print(F("readPowerActiveReactive: pactive: 0x"));
-    _debugPort->println(signedUnsigned.unSigned, HEX);
+    _debugPort->println((uint16_t)pactive, HEX);
     _debugPort->print(F("readPowerActiveReactive: pactive (LSB, before correction) is "));
     _debugPort->println(power);
   }
-  float LSBpermW = 3.08; // LSB per mW
-  LSBpermW *= 30.0 / _currentSensingRange; // Correct for sensor version
-  power /= LSBpermW; //Convert from codes to mW
-  //Correct for the voltage divider: (RISO1 + RISO2 + RSENSE) / RSENSE
-  //Or:  (RISO1 + RISO2 + RISO3 + RISO4 + RSENSE) / RSENSE
-  float resistorMultiplier = (_dividerResistance + _senseResistance) / _senseResistance;
-  power *= resistorMultiplier;
-  power /= 1000; // Convert from mW to W
+  power *= _calibration.wattsPerCode; //Convert to W, correcting for the voltage divider
   if (_printDebug == true)
   {
     _debugPort->print(F("readPowerActiveReactive: pactive (W, after correction) is "));
@@ -658,21 +612,16 @@ ACS37800ERR ACS37800::readPowerActiveReactive(float *pActive, float *pReactive)
   // Datasheet also says:
   //  "6.15 LSB/mVAR for the 30A version and 2.05 LSB/mVAR for the 90A version"
 
-  power = (float)store.data.bits.pimag;
+  int32_t pimag = ACS37800_FIELD_PIMAG::extract(store); // pimag is unsigned
+  power = (float)pimag;
   if (_printDebug == true)
   {
     _debugPort->print(F("readPowerActiveReactive: pimag: 0x"));
-    _debugPort->println(store.data.bits.pimag, HEX);
+    _debugPort->println(pimag, HEX);
     _debugPort->print(F("readPowerActiveReactive: pimag (LSB, before correction) is "));
     _debugPort->println(power);
   }
-  float LSBpermVAR = 6.15; // LSB per mVAR
-  LSBpermVAR *= 30.0 / _currentSensingRange; // Correct for sensor version
-  power /= LSBpermVAR; //Convert from codes to mVAR
-  //Correct for the voltage divider: (RISO1 + RISO2 + RSENSE) / RSENSE
-  //Or:  (RISO1 + RISO2 + RISO3 + RISO4 + RSENSE) / RSENSE
-  power *= resistorMultiplier;
-  power /= 1000; // Convert from mVAR to VAR
+  power *= _calibration.varPerCode; //Convert to VAR, correcting for the voltage divider
   if (_printDebug == true)
   {
     _debugPort->print(F("readPowerActiveReactive: pimag (VAR, after correction) is "));
@@ -686,8 +635,8 @@ ACS37800ERR ACS37800::readPowerActiveReactive(float *pActive, float *pReactive)
 // Read volatile register 0x22. Return the apparent power, power factor, leading / lagging, generated / consumed
 ACS37800ERR ACS37800::readPowerFactor(float *pApparent, float *pFactor, bool *posangle, bool *pospf)
 {
-  ACS37800_REGISTER_22_t store;
-  ACS37800ERR error = readRegister(&store.data.all, ACS37800_REGISTER_VOLATILE_22); // Read register 22
+  uint32_t store;
+  ACS37800ERR error = readRegister(&store, ACS37800_REGISTER_VOLATILE_22); // Read register 22
 
   if (error != ACS37800_SUCCESS)
   {
@@ -709,22 +658,16 @@ ACS37800ERR ACS37800::readPowerFactor(float *pApparent, float *pFactor, bool *po
   // Datasheet also says:
   //  "6.15 LSB/mVA for the 30A version and 2.05 LSB/mVA for the 90A version"
 
-  float power = (float)store.data.bits.papparent;
+  int32_t papparent = ACS37800_FIELD_PAPPARENT::extract(store); // papparent is unsigned
+  float power = (float)papparent;
   if (_printDebug == true)
   {
     _debugPort->print(F("readPowerFactor: papparent: 0x"));
-    _debugPort->println(store.data.bits.papparent, HEX);
+    _debugPort->println(papparent, HEX);
     _debugPort->print(F("readPowerFactor: papparent (LSB, before correction) is "));
     _debugPort->println(power);
   }
-  float LSBpermVA = 6.15; // LSB per mVA
-  LSBpermVA *= 30.0 / _currentSensingRange; // Correct for sensor version
-  power /= LSBpermVA; //Convert from codes to mVA
-  //Correct for the voltage divider: (RISO1 + RISO2 + RSENSE) / RSENSE
-  //Or:  (RISO1 + RISO2 + RISO3 + RISO4 + RSENSE) / RSENSE
-  float resistorMultiplier = (_dividerResistance + _senseResistance) / _senseResistance;
-  power *= resistorMultiplier;
-  power /= 1000; // Convert from mVAR to VAR
+  power *= _calibration.vaPerCode; //Convert to VA, correcting for the voltage divider
   if (_printDebug == true)
   {
     _debugPort->print(F("readPowerFactor: papparent (VA, after correction) is "));
@@ -738,27 +681,20 @@ ACS37800ERR ACS37800::readPowerFactor(float *pApparent, float *pFactor, bool *po
   //  with 10 fractional bits. It ranges from –1 to ~1 with a step
   //  size of 2^-10."
 
-  union
-  {
-    int16_t Signed;
-    uint16_t unSigned;
-  } signedUnsigned; // Avoid any ambiguity when casting to signed int
-
-  signedUnsigned.unSigned = store.data.bits.pfactor << 5; // Move 11-bit number into 16-bits (signed)
-
-  float pfactor = (float)signedUnsigned.Signed / 32768.0; // Convert to +/- 1
+  int32_t pfactorCodes = ACS37800_FIELD_PFACTOR::extract(store); // Sign-extended from 11 bits
+  float pfactor = (float)pfactorCodes / 1024.0; // Convert to +/- 1
   if (_printDebug == true)
   {
     _debugPort->print(F("readPowerFactor: pfactor: 0x"));
-    _debugPort->println(store.data.bits.pfactor, HEX);
+    _debugPort->println(pfactorCodes & 0x7FF, HEX);
     _debugPort->print(F("readPowerFactor: pfactor is "));
     _debugPort->println(pfactor);
   }
   *pFactor = pfactor;
 
   // Extract posangle and pospf
-  *posangle = store.data.bits.posangle & 0x1;
-  *pospf = store.data.bits.pospf & 0x1;
+  *posangle = ACS37800_FIELD_POSANGLE::extract(store);
+  *pospf = ACS37800_FIELD_POSPF::extract(store);
 
   return (error);
 }
@@ -766,8 +702,8 @@ ACS37800ERR ACS37800::readPowerFactor(float *pApparent, float *pFactor, bool *po
 // Read volatile registers 0x2A and 0x2C. Return the vInst (Volts), iInst (Amps) and pInst (VAR).
 ACS37800ERR ACS37800::readInstantaneous(float *vInst, float *iInst, float *pInst)
 {
-  ACS37800_REGISTER_2A_t store;
-  ACS37800ERR error = readRegister(&store.data.all, ACS37800_REGISTER_VOLATILE_2A); // Read register 2A
+  uint32_t store;
+  ACS37800ERR error = readRegister(&store, ACS37800_REGISTER_VOLATILE_2A); // Read register 2A
 
   if (error != ACS37800_SUCCESS)
   {
@@ -779,32 +715,18 @@ ACS37800ERR ACS37800::readInstantaneous(float *vInst, float *iInst, float *pInst
     return (error); // Bail
   }
 
-  //Extract the vcodes. Convert to voltage in Volts.
-  union
-  {
-    int16_t Signed;
-    uint16_t unSigned;
-  } signedUnsigned; // Avoid any ambiguity when casting to signed int
-
-  //Extract vcodes as signed int
-  //vcodes as actually int16_t but is stored in a uint32_t as a 16-bit bitfield
-  signedUnsigned.unSigned = store.data.bits.vcodes;
-  float volts = (float)signedUnsigned.Signed;
+  //Extract the vcodes as signed int. Convert to voltage in Volts.
+  int32_t vcodes = ACS37800_FIELD_VCODES::extract(store);
+  float volts = (float)vcodes;
   if (_printDebug == true)
   {
     _debugPort->print(F("readInstantaneous: vcodes: 0x"));
-    _debugPort->println(signedUnsigned.unSigned, HEX);
+    _debugPort->println((uint16_t)vcodes, HEX);
     _debugPort->print(F("readInstantaneous: volts (LSB, before correction) is "));
     _debugPort->println(volts);
   }
   // Datasheet says "Voltage Channel ADC Sensitivity: 110 LSB/mV"
-  volts /= 27500.0; //Convert from codes to the fraction of ADC Full Scale
-  volts *= 250; //Convert to mV (Differential Input Range is +/- 250mV)
-  volts /= 1000; //Convert to Volts
-  //Correct for the voltage divider: (RISO1 + RISO2 + RSENSE) / RSENSE
-  //Or:  (RISO1 + RISO2 + RISO3 + RISO4 + RSENSE) / RSENSE
-  float resistorMultiplier = (_dividerResistance + _senseResistance) / _senseResistance;
-  volts *= resistorMultiplier;
+  volts *= _calibration.voltsPerCodeInst; //Convert to Volts, correcting for the voltage divider
   if (_printDebug == true)
   {
     _debugPort->print(F("readInstantaneous: volts (V, after correction) is "));
@@ -813,17 +735,16 @@ ACS37800ERR ACS37800::readInstantaneous(float *vInst, float *iInst, float *pInst
   *vInst = volts;
 
   //Extract the icodes. Convert to current in Amps.
-  signedUnsigned.unSigned = store.data.bits.icodes; //Extract icodes as signed int
-  float amps = (float)signedUnsigned.Signed;
+  int32_t icodes = ACS37800_FIELD_ICODES::extract(store); //Extract icodes as signed int
+  float amps = (float)icodes;
   if (_printDebug == true)
   {
     _debugPort->print(F("readInstantaneous: icodes: 0x"));
-    _debugPort->println(signedUnsigned.unSigned, HEX);
+    _debugPort->println((uint16_t)icodes, HEX);
     _debugPort->print(F("readInstantaneous: amps (LSB, before correction) is "));
     _debugPort->println(amps);
   }
-  amps /= 27500.0; //Convert from codes to the fraction of ADC Full Scale
-  amps *= _currentSensingRange; //Convert to Amps
+  amps *= _calibration.ampsPerCodeInst; //Convert to Amps
   if (_printDebug == true)
   {
     _debugPort->print(F("readInstantaneous: amps (A, after correction) is "));
@@ -831,8 +752,8 @@ ACS37800ERR ACS37800::readInstantaneous(float *vInst, float *iInst, float *pInst
   }
   *iInst = amps;
 
-  ACS37800_REGISTER_2C_t pstore;
-  error = readRegister(&pstore.data.all, ACS37800_REGISTER_VOLATILE_2C); // Read register 2C
+  uint32_t pstore;
+  error = readRegister(&pstore, ACS37800_REGISTER_VOLATILE_2C); // Read register 2C
 
   if (error != ACS37800_SUCCESS)
   {
@@ -845,24 +766,16 @@ ACS37800ERR ACS37800::readInstantaneous(float *vInst, float *iInst, float *pInst
   }
 
   //Extract pinstant as signed int. Convert to W
-  //pinstant as actually int16_t but is stored in a uint32_t as a 16-bit bitfield
-  signedUnsigned.unSigned = pstore.data.bits.pinstant;
-  float power = (float)signedUnsigned.Signed;
+  int32_t pinstant = ACS37800_FIELD_PINSTANT::extract(pstore);
+  float power = (float)pinstant;
   if (_printDebug == true)
   {
     _debugPort->print(F("readInstantaneous: pinstant: 0x"));
-    _debugPort->println(signedUnsigned.unSigned, HEX);
+    _debugPort->println((uint16_t)pinstant, HEX);
     _debugPort->print(F("readInstantaneous: power (LSB, before correction) is "));
     _debugPort->println(power);
   }
-  //Datasheet says: 3.08 LSB/mW for the 30A version and 1.03 LSB/mW for the 90A version
-  float LSBpermW = 3.08; // LSB per mW
-  LSBpermW *= 30.0 / _currentSensingRange; // Correct for sensor version
-  power /= LSBpermW; //Convert from codes to mW
-  //Correct for the voltage divider: (RISO1 + RISO2 + RSENSE) / RSENSE
-  //Or:  (RISO1 + RISO2 + RISO3 + RISO4 + RSENSE) / RSENSE
-  power *= resistorMultiplier;
-  power /= 1000; // Convert from mW to W
+  power *= _calibration.wattsPerCode; //Convert to W, correcting for the voltage divider
   if (_printDebug == true)
   {
     _debugPort->print(F("readInstantaneous: power (W, after correction) is "));
@@ -890,22 +803,2563 @@ ACS37800ERR ACS37800::readErrorFlags(ACS37800_REGISTER_2D_t *errorFlags)
   return (error);
 }
 
-//Change the value of the sense resistor (Ohms)
-void ACS37800::setSenseRes(float newRes)
+//Read volatile register 0x26 (or 0x27 if oneMinute is true). Return the averaged vRMS (Volts) and iRMS (Amps).
+//The averages use the same scaling as vrms and irms
+ACS37800ERR ACS37800::readRMSAverage(float *vRMS, float *iRMS, bool oneMinute)
 {
-  _senseResistance = newRes;
+  uint32_t store; // 0x27 has the same layout as 0x26
+  uint8_t address = oneMinute ? ACS37800_REGISTER_VOLATILE_27 : ACS37800_REGISTER_VOLATILE_26;
+  ACS37800ERR error = readRegister(&store, address); // Read register 26 or 27
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("readRMSAverage: readRegister (0x"));
+      _debugPort->print(address, HEX);
+      _debugPort->print(F(") returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  *vRMS = (float)ACS37800_FIELD_VRMSAVGONESEC::extract(store) * _calibration.voltsPerCodeRMS;
+  *iRMS = (float)ACS37800_FIELD_IRMSAVGONESEC::extract(store) * _calibration.ampsPerCodeRMS; // irms is signed
+
+  return (error);
 }
 
-//Change the value of the voltage divider resistance (Ohms)
-void ACS37800::setDividerRes(float newRes)
+//Read volatile register 0x28 (or 0x29 if oneMinute is true). Return the averaged pactive (Watts).
+//The averages use the same scaling as pactive
+ACS37800ERR ACS37800::readPowerAverage(float *pActive, bool oneMinute)
 {
-  _dividerResistance = newRes;
+  uint32_t store; // 0x29 has the same layout as 0x28
+  uint8_t address = oneMinute ? ACS37800_REGISTER_VOLATILE_29 : ACS37800_REGISTER_VOLATILE_28;
+  ACS37800ERR error = readRegister(&store, address); // Read register 28 or 29
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("readPowerAverage: readRegister (0x"));
+      _debugPort->print(address, HEX);
+      _debugPort->print(F(") returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  *pActive = (float)ACS37800_FIELD_PACTAVGONESEC::extract(store) * _calibration.wattsPerCode; // pactive is signed
+
+  return (error);
 }
 
-//Change the current-sensing range (Amps)
-//ACS37800KMACTR-030B3-I2C is a 30.0 Amp part - as used on the SparkFun Qwiic Power Meter
-//ACS37800KMACTR-090B3-I2C is a 90.0 Amp part
-void ACS37800::setCurrentRange(float newCurrent)
+//Read registers 0x20 - 0x22 just after the chip updates them
+//If the registers have not changed, the read was early: retry once, period / 8 later.
+//If that retry sees the change, the update happened between the two reads: the schedule is locked to the chip.
+//If it does not, the readings may simply be steady (e.g. no load), so back off to one read per period.
+//Once locked, the next update is expected one period after the last one and the read is scheduled a little after that (period / 16).
+//Until then, reads are scheduled a quarter period early so that a stale read (and lock) happens within a few periods.
+//The lock is dropped (to correct for drift between the clocks) whenever numptsout is re-read.
+ACS37800ERR ACS37800::pollMeasurements(ACS37800_MEASUREMENTS_t *measurements, bool *fresh)
 {
-  _currentSensingRange = newCurrent;
+  *fresh = false;
+
+  if (_pollStarted && ((long)(micros() - _pollNextRead) < 0))
+    return (ACS37800_SUCCESS); // Too soon. Nothing to do
+
+  if ((!_pollStarted) || (_pollUpdates >= ACS37800_NUMPTSOUT_REFRESH))
+  {
+    ACS37800ERR error = readUpdatePeriod(); // (Re)read numptsout
+
+    if (error != ACS37800_SUCCESS)
+      return (error); // Bail. Try again next time
+  }
+
+  uint32_t registers[3];
+  unsigned long now = micros();
+  ACS37800ERR error = readRegisters(registers, ACS37800_REGISTER_VOLATILE_20, 3); // Read registers 20, 21 and 22
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("pollMeasurements: readRegisters (20-22) returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail. Try again next time
+  }
+
+  bool changed = (registers[0] != _pollRegisters[0]) || (registers[1] != _pollRegisters[1]) || (registers[2] != _pollRegisters[2]);
+
+  if (_pollStarted && (!changed) && (now - _pollUpdatedAt < 2 * _pollPeriod))
+  {
+    if (_pollStale < 255)
+      _pollStale++;
+    _pollReadAt = now;
+    if (_pollStale == 1)
+      _pollNextRead = now + (_pollPeriod >> 3); // Too early? Try again soon
+    else
+      _pollNextRead = now + _pollPeriod; // Probably steady. Back off
+    return (ACS37800_SUCCESS);
+  }
+
+  if (_pollStarted && changed && (_pollStale == 1))
+  {
+    _pollUpdatedAt = now - ((now - _pollReadAt) >> 1); // The update was between the stale read and now
+    _pollLocked = true;
+  }
+  else if (_pollStarted && _pollLocked)
+    _pollUpdatedAt += ((now - _pollUpdatedAt) / _pollPeriod) * _pollPeriod; // The latest expected update
+  else
+    _pollUpdatedAt = now; // The update was at or before now
+
+  _pollStarted = true;
+  _pollStale = 0;
+  _pollReadAt = now;
+  if (_pollLocked)
+    _pollNextRead = _pollUpdatedAt + _pollPeriod + (_pollPeriod >> 4); // Just after the next update
+  else
+    _pollNextRead = _pollUpdatedAt + _pollPeriod - (_pollPeriod >> 2); // Early, to find the update
+  _pollUpdates++;
+  for (uint8_t i = 0; i < 3; i++)
+    _pollRegisters[i] = registers[i];
+
+  decodeMeasurements(registers[0], registers[1], registers[2], _calibration, measurements);
+  *fresh = true;
+
+  return (ACS37800_SUCCESS);
+}
+
+//Read numptsout (0x25) and convert it to the update period of 0x20 - 0x22 in microseconds
+ACS37800ERR ACS37800::readUpdatePeriod()
+{
+  uint32_t store;
+  ACS37800ERR error = readRegister(&store, ACS37800_REGISTER_VOLATILE_25); // Read register 25
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("readUpdatePeriod: readRegister (25) returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  uint32_t numptsout = ACS37800_FIELD_NUMPTSOUT::extract(store);
+  if (numptsout == 0)
+    numptsout = 1; // Should never happen. Poll at the sample rate
+
+  _pollPeriod = (numptsout * 1000000UL) / ACS37800_SAMPLE_RATE;
+  _pollUpdates = 0;
+  _pollLocked = false; // Find the update again
+
+  if (_printDebug == true)
+  {
+    _debugPort->print(F("readUpdatePeriod: numptsout is "));
+    _debugPort->print(numptsout);
+    _debugPort->print(F(". Update period (us) is "));
+    _debugPort->println(_pollPeriod);
+  }
+
+  return (error);
+}
+
+//Return the update period used by pollMeasurements (microseconds)
+unsigned long ACS37800::getUpdatePeriod()
+{
+  return (_pollPeriod);
+}
+
+//Re-read numptsout and restart the schedule on the next poll
+void ACS37800::resetPollMeasurements()
+{
+  _pollStarted = false;
+}
+
+//Read the one second (or one minute) averages, if a second (or minute) has passed since they were last read
+ACS37800ERR ACS37800::pollAverages(ACS37800_AVERAGES_t *averages, bool *updated, bool oneMinute)
+{
+  uint8_t which = oneMinute ? 1 : 0;
+  unsigned long period = oneMinute ? 60000 : 1000;
+  unsigned long now = millis();
+
+  *updated = false;
+
+  if (_averagesRead[which] && (now - _averagesReadAt[which] < period))
+    return (ACS37800_SUCCESS); // Too soon. Nothing to do
+
+  ACS37800ERR error = readRMSAverage(&averages->vRMS, &averages->iRMS, oneMinute);
+  if (error == ACS37800_SUCCESS)
+    error = readPowerAverage(&averages->pActive, oneMinute);
+
+  if (error != ACS37800_SUCCESS)
+    return (error); // Bail. Try again next time
+
+  averages->timestamp = now;
+  _averagesReadAt[which] = now;
+  _averagesRead[which] = true;
+  *updated = true;
+
+  return (ACS37800_SUCCESS);
+}
+
+// Read volatile registers 0x20, 0x21 and 0x22. Return the RMS, power and power factor readings.
+// The three registers are read back-to-back before anything is decoded, keeping the time between the
+// readings as short as possible so they (almost always) come from the same calculation cycle.
+ACS37800ERR ACS37800::readMeasurements(ACS37800_MEASUREMENTS_t *measurements)
+{
+  uint32_t registers[3];
+  ACS37800ERR error = readRegisters(registers, ACS37800_REGISTER_VOLATILE_20, 3); // Read registers 20, 21 and 22
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("readMeasurements: readRegisters (20-22) returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  decodeMeasurements(registers[0], registers[1], registers[2], _calibration, measurements);
+
+  return (error);
+}
+
+// Read volatile registers 0x20, 0x21, 0x22, 0x2A and 0x2C. Return their raw contents in snapshot.
+// No float math is done here. Use decode to convert the snapshot later.
+ACS37800ERR ACS37800::readRaw(ACS37800_RAW_SNAPSHOT_t *snapshot)
+{
+  uint32_t registers[3];
+  ACS37800ERR error = readRegisters(registers, ACS37800_REGISTER_VOLATILE_20, 3); // Read registers 20, 21 and 22
+
+  if (error == ACS37800_SUCCESS)
+    error = readRegister(&snapshot->reg2A, ACS37800_REGISTER_VOLATILE_2A); // Read register 2A
+
+  if (error == ACS37800_SUCCESS)
+    error = readRegister(&snapshot->reg2C, ACS37800_REGISTER_VOLATILE_2C); // Read register 2C
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("readRaw: failed! error is: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  snapshot->reg20 = registers[0];
+  snapshot->reg21 = registers[1];
+  snapshot->reg22 = registers[2];
+
+  return (error);
+}
+
+//Read the registers selected by contents (ACS37800_RECORD_CONTENT_e bits) into record
+ACS37800ERR ACS37800::readRecord(ACS37800_RECORD_t *record, uint8_t deviceId, uint8_t contents)
+{
+  const uint8_t addresses[6] = { ACS37800_REGISTER_VOLATILE_20, ACS37800_REGISTER_VOLATILE_21, ACS37800_REGISTER_VOLATILE_22,
+                                 ACS37800_REGISTER_VOLATILE_2A, ACS37800_REGISTER_VOLATILE_2C, ACS37800_REGISTER_VOLATILE_2D };
+  uint32_t *registers[6] = { &record->reg20, &record->reg21, &record->reg22, &record->reg2A, &record->reg2C, &record->reg2D };
+
+  record->deviceId = deviceId;
+  record->contents = contents & ACS37800_RECORD_ALL;
+  record->timestamp = micros();
+
+  for (uint8_t bit = 0; bit < 6; bit++)
+  {
+    *registers[bit] = 0;
+    if ((record->contents & (1 << bit)) == 0)
+      continue;
+
+    ACS37800ERR error = readRegister(registers[bit], addresses[bit]);
+
+    if (error != ACS37800_SUCCESS)
+    {
+      if (_printDebug == true)
+      {
+        _debugPort->print(F("readRecord: readRegister (0x"));
+        _debugPort->print(addresses[bit], HEX);
+        _debugPort->print(F(") returned: "));
+        _debugPort->println(error);
+      }
+      return (error); // Bail
+    }
+  }
+
+  return (ACS37800_SUCCESS);
+}
+
+//Read the registers selected by contents and write them to stream as one binary record
+ACS37800ERR ACS37800::writeRecord(Stream &stream, ACS37800RecordEncoder &encoder, uint8_t deviceId, uint8_t contents)
+{
+  ACS37800_RECORD_t record;
+  ACS37800ERR error = readRecord(&record, deviceId, contents);
+
+  if (error != ACS37800_SUCCESS)
+    return (error); // Bail. Nothing is written, so the encoder state is unchanged
+
+  uint8_t buffer[ACS37800_RECORD_MAX_SIZE];
+  size_t length = encoder.encode(record, buffer);
+  stream.write(buffer, length);
+
+  return (ACS37800_SUCCESS);
+}
+
+//Decode a raw snapshot using the supplied conversion factors
+void ACS37800::decode(const ACS37800_RAW_SNAPSHOT_t &snapshot, const ACS37800_CALIBRATION_t &calibration, ACS37800_DECODED_SNAPSHOT_t *decoded)
+{
+  decodeMeasurements(snapshot.reg20, snapshot.reg21, snapshot.reg22, calibration, &decoded->measurements);
+
+  decoded->vInst = (float)ACS37800_FIELD_VCODES::extract(snapshot.reg2A) * calibration.voltsPerCodeInst; // vcodes is signed
+  decoded->iInst = (float)ACS37800_FIELD_ICODES::extract(snapshot.reg2A) * calibration.ampsPerCodeInst; // icodes is signed
+  decoded->pInst = (float)ACS37800_FIELD_PINSTANT::extract(snapshot.reg2C) * calibration.wattsPerCode; // pinstant is signed
+}
+
+//Split count raw 0x2A (and 0x2C) register contents into separate code arrays. reg2C can be NULL.
+void ACS37800::unpackInstantaneous(const uint32_t *reg2A, const uint32_t *reg2C, uint32_t count, int16_t *vCodes, int16_t *iCodes, int16_t *pCodes)
+{
+  if ((reg2A != NULL) && (vCodes != NULL))
+    for (uint32_t i = 0; i < count; i++)
+      vCodes[i] = ACS37800_FIELD_VCODES::extract(reg2A[i]);
+  if ((reg2A != NULL) && (iCodes != NULL))
+    for (uint32_t i = 0; i < count; i++)
+      iCodes[i] = ACS37800_FIELD_ICODES::extract(reg2A[i]);
+  if ((reg2C != NULL) && (pCodes != NULL))
+    for (uint32_t i = 0; i < count; i++)
+      pCodes[i] = ACS37800_FIELD_PINSTANT::extract(reg2C[i]);
+}
+
+//Decode count instantaneous samples to Volts, Amps and Watts
+void ACS37800::decodeInstantaneous(const int16_t *vCodes, const int16_t *iCodes, const int16_t *pCodes, uint32_t count,
+                                   const ACS37800_CALIBRATION_t &calibration, float *volts, float *amps, float *watts)
+{
+  if ((vCodes != NULL) && (volts != NULL))
+    scaleCodes(vCodes, volts, count, calibration.voltsPerCodeInst);
+  if ((iCodes != NULL) && (amps != NULL))
+    scaleCodes(iCodes, amps, count, calibration.ampsPerCodeInst);
+  if ((pCodes != NULL) && (watts != NULL))
+    scaleCodes(pCodes, watts, count, calibration.wattsPerCode);
+}
+
+//Decode count instantaneous samples to mV, mA and mW. No float math.
+void ACS37800::decodeInstantaneousInt(const int16_t *vCodes, const int16_t *iCodes, const int16_t *pCodes, uint32_t count,
+                                      const ACS37800_CALIBRATION_t &calibration, int32_t *milliVolts, int32_t *milliAmps, int32_t *milliWatts)
+{
+  if ((vCodes != NULL) && (milliVolts != NULL))
+    scaleCodesFixed(vCodes, milliVolts, count, calibration.milliVoltsInst);
+  if ((iCodes != NULL) && (milliAmps != NULL))
+    scaleCodesFixed(iCodes, milliAmps, count, calibration.milliAmpsInst);
+  if ((pCodes != NULL) && (milliWatts != NULL))
+    scaleCodesFixed(pCodes, milliWatts, count, calibration.milliWatts);
+}
+
+//Batch decode kernel: result[i] = codes[i] * unitsPerCode
+//__restrict and the loop-invariant scale let the compiler vectorize this
+void ACS37800::scaleCodes(const int16_t *__restrict codes, float *__restrict result, uint32_t count, float unitsPerCode)
+{
+  for (uint32_t i = 0; i < count; i++)
+    result[i] = (float)codes[i] * unitsPerCode;
+}
+
+//Batch decode kernel: result[i] = applyFixedScale(codes[i], scale)
+//The rounding term is hoisted out of the loop. With shift == 0 it is zero, and shifting by zero is a no-op, so the result is the same.
+//The product fits in 48 bits (16-bit code x 32-bit multiplier)
+void ACS37800::scaleCodesFixed(const int16_t *__restrict codes, int32_t *__restrict result, uint32_t count, const ACS37800_FIXED_SCALE_t &scale)
+{
+  const int64_t multiplier = scale.multiplier;
+  const uint8_t shift = scale.shift;
+  const int64_t round = (shift > 0) ? (((int64_t)1) << (shift - 1)) : 0;
+  for (uint32_t i = 0; i < count; i++)
+    result[i] = (int32_t)(((int64_t)codes[i] * multiplier + round) >> shift);
+}
+
+//Decode the contents of registers 0x20, 0x21 and 0x22 using the supplied conversion factors
+//See readRMS, readPowerActiveReactive and readPowerFactor for the details of each field
+void ACS37800::decodeMeasurements(uint32_t reg20Data, uint32_t reg21Data, uint32_t reg22Data, const ACS37800_CALIBRATION_t &calibration, ACS37800_MEASUREMENTS_t *measurements)
+{
+  measurements->vRMS = (float)ACS37800_FIELD_VRMS::extract(reg20Data) * calibration.voltsPerCodeRMS; // vrms is unsigned
+  measurements->iRMS = (float)ACS37800_FIELD_IRMS::extract(reg20Data) * calibration.ampsPerCodeRMS; // irms is signed
+
+  measurements->pActive = (float)ACS37800_FIELD_PACTIVE::extract(reg21Data) * calibration.wattsPerCode; // pactive is signed
+  measurements->pReactive = (float)ACS37800_FIELD_PIMAG::extract(reg21Data) * calibration.varPerCode; // pimag is unsigned
+
+  measurements->pApparent = (float)ACS37800_FIELD_PAPPARENT::extract(reg22Data) * calibration.vaPerCode; // papparent is unsigned
+  measurements->pFactor = (float)ACS37800_FIELD_PFACTOR::extract(reg22Data) / 1024.0; // Signed 11-bit with 10 fractional bits. Convert to +/- 1
+  measurements->posangle = ACS37800_FIELD_POSANGLE::extract(reg22Data);
+  measurements->pospf = ACS37800_FIELD_POSPF::extract(reg22Data);
+}
+
+// Read volatile register 0x20. Return the vRMS (mV) and iRMS (mA). No float math.
+ACS37800ERR ACS37800::readRMSInt(int32_t *milliVolts, int32_t *milliAmps)
+{
+  uint32_t store;
+  ACS37800ERR error = readRegister(&store, ACS37800_REGISTER_VOLATILE_20); // Read register 20
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("readRMSInt: readRegister (20) returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  *milliVolts = applyFixedScale(ACS37800_FIELD_VRMS::extract(store), _calibration.milliVoltsRMS); // vrms is unsigned
+  *milliAmps = applyFixedScale(ACS37800_FIELD_IRMS::extract(store), _calibration.milliAmpsRMS); // irms is signed
+
+  return (error);
+}
+
+// Read volatile register 0x21. Return the pactive (mW) and pimag (mVAR). No float math.
+ACS37800ERR ACS37800::readPowerActiveReactiveInt(int32_t *milliWatts, int32_t *milliVAR)
+{
+  uint32_t store;
+  ACS37800ERR error = readRegister(&store, ACS37800_REGISTER_VOLATILE_21); // Read register 21
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("readPowerActiveReactiveInt: readRegister (21) returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  *milliWatts = applyFixedScale(ACS37800_FIELD_PACTIVE::extract(store), _calibration.milliWatts); // pactive is signed
+  *milliVAR = applyFixedScale(ACS37800_FIELD_PIMAG::extract(store), _calibration.milliVAR); // pimag is unsigned
+
+  return (error);
+}
+
+// Read volatile register 0x22. Return the apparent power (mVA), power factor (Q15), leading / lagging, generated / consumed. No float math.
+ACS37800ERR ACS37800::readPowerFactorInt(int32_t *milliVA, int16_t *pFactorQ15, bool *posangle, bool *pospf)
+{
+  uint32_t store;
+  ACS37800ERR error = readRegister(&store, ACS37800_REGISTER_VOLATILE_22); // Read register 22
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("readPowerFactorInt: readRegister (22) returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  *milliVA = applyFixedScale(ACS37800_FIELD_PAPPARENT::extract(store), _calibration.milliVA); // papparent is unsigned
+
+  // pfactor is a signed 11-bit fixed point number with 10 fractional bits
+  // Shifting it up by 5 bits gives Q15 directly
+  *pFactorQ15 = (int16_t)(ACS37800_FIELD_PFACTOR::extract(store) * 32);
+
+  *posangle = ACS37800_FIELD_POSANGLE::extract(store);
+  *pospf = ACS37800_FIELD_POSPF::extract(store);
+
+  return (error);
+}
+
+// Read volatile registers 0x2A and 0x2C. Return the vInst (mV), iInst (mA) and pInst (mW). No float math.
+ACS37800ERR ACS37800::readInstantaneousInt(int32_t *milliVolts, int32_t *milliAmps, int32_t *milliWatts)
+{
+  uint32_t store;
+  ACS37800ERR error = readRegister(&store, ACS37800_REGISTER_VOLATILE_2A); // Read register 2A
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("readInstantaneousInt: readRegister (2A) returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  *milliVolts = applyFixedScale(ACS37800_FIELD_VCODES::extract(store), _calibration.milliVoltsInst);
+  *milliAmps = applyFixedScale(ACS37800_FIELD_ICODES::extract(store), _calibration.milliAmpsInst);
+
+  uint32_t pstore;
+  error = readRegister(&pstore, ACS37800_REGISTER_VOLATILE_2C); // Read register 2C
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("readInstantaneousInt: readRegister (2C) returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  *milliWatts = applyFixedScale(ACS37800_FIELD_PINSTANT::extract(pstore), _calibration.milliWatts);
+
+  return (error);
+}
+
+//Change the value of the sense resistor (Ohms)
+void ACS37800::setSenseRes(float newRes)
+{
+  _senseResistance = newRes;
+  updateCalibration();
+}
+
+//Change the value of the voltage divider resistance (Ohms)
+void ACS37800::setDividerRes(float newRes)
+{
+  _dividerResistance = newRes;
+  updateCalibration();
+}
+
+//Change the current-sensing range (Amps)
+//ACS37800KMACTR-030B3-I2C is a 30.0 Amp part - as used on the SparkFun Qwiic Power Meter
+//ACS37800KMACTR-090B3-I2C is a 90.0 Amp part
+void ACS37800::setCurrentRange(float newCurrent)
+{
+  _currentSensingRange = newCurrent;
+  updateCalibration();
+}
+
+//Return a copy of the conversion factors
+void ACS37800::getCalibration(ACS37800_CALIBRATION_t *calibration)
+{
+  *calibration = _calibration;
+}
+
+//Recalculate the conversion factors from the resistances and the current-sensing range
+//This is the only place the float divisions happen. The read functions just multiply.
+void ACS37800::updateCalibration()
+{
+  //Correct for the voltage divider: (RISO1 + RISO2 + RSENSE) / RSENSE
+  //Or:  (RISO1 + RISO2 + RISO3 + RISO4 + RSENSE) / RSENSE
+  float resistorMultiplier = (_dividerResistance + _senseResistance) / _senseResistance;
+
+  // Voltage: Differential Input Range is +/- 250mV
+  // Datasheet says "Voltage Channel ADC Sensitivity: 110 LSB/mV"
+  // vrms full scale is 55000 codes. vcodes full scale is 27500 codes.
+  _calibration.voltsPerCodeRMS = resistorMultiplier * 250.0 / (55000.0 * 1000.0);
+  _calibration.voltsPerCodeInst = resistorMultiplier * 250.0 / (27500.0 * 1000.0);
+
+  // Current: irms full scale is 55000 codes. icodes full scale is 27500 codes.
+  _calibration.ampsPerCodeRMS = _currentSensingRange / 55000.0;
+  _calibration.ampsPerCodeInst = _currentSensingRange / 27500.0;
+
+  // Power: datasheet says:
+  //  "3.08 LSB/mW for the 30A version and 1.03 LSB/mW for the 90A version"
+  //  "6.15 LSB/mVAR (and mVA) for the 30A version and 2.05 LSB/mVAR (and mVA) for the 90A version"
+  float LSBpermW = 3.08 * 30.0 / _currentSensingRange; // Correct for sensor version
+  float LSBpermVAR = 6.15 * 30.0 / _currentSensingRange; // Correct for sensor version
+  _calibration.wattsPerCode = resistorMultiplier / (LSBpermW * 1000.0); // Convert from mW to W
+  _calibration.varPerCode = resistorMultiplier / (LSBpermVAR * 1000.0); // Convert from mVAR to VAR
+  _calibration.vaPerCode = _calibration.varPerCode; // Apparent power has the same scaling as reactive
+
+  // Integer versions of the above - in milli-units
+  _calibration.milliVoltsRMS = calculateFixedScale(_calibration.voltsPerCodeRMS * 1000.0);
+  _calibration.milliAmpsRMS = calculateFixedScale(_calibration.ampsPerCodeRMS * 1000.0);
+  _calibration.milliVoltsInst = calculateFixedScale(_calibration.voltsPerCodeInst * 1000.0);
+  _calibration.milliAmpsInst = calculateFixedScale(_calibration.ampsPerCodeInst * 1000.0);
+  _calibration.milliWatts = calculateFixedScale(_calibration.wattsPerCode * 1000.0);
+  _calibration.milliVAR = calculateFixedScale(_calibration.varPerCode * 1000.0);
+  _calibration.milliVA = calculateFixedScale(_calibration.vaPerCode * 1000.0);
+}
+
+//Convert a (positive) float scale into an integer multiplier and shift
+//The shift is chosen to keep as many significant bits as possible while the multiplier still fits in 31 bits.
+//The codes are at most 16 bits, so (code * multiplier) always fits in an int64_t.
+ACS37800_FIXED_SCALE_t ACS37800::calculateFixedScale(float unitsPerCode)
+{
+  ACS37800_FIXED_SCALE_t scale;
+  scale.shift = 0;
+  float multiplier = unitsPerCode;
+
+  while ((multiplier < 1073741824.0) && (scale.shift < 40)) // Keep doubling until the multiplier is >= 2^30
+  {
+    multiplier *= 2.0;
+    scale.shift++;
+  }
+  while ((multiplier >= 2147483648.0) && (scale.shift > 0)) // Scales >= 1.0 need fewer fractional bits
+  {
+    multiplier /= 2.0;
+    scale.shift--;
+  }
+
+  scale.multiplier = (int32_t)(multiplier + 0.5); // Round to nearest
+  return (scale);
+}
+
+//Apply an integer scale to a raw code. The result is rounded to the nearest integer.
+int32_t ACS37800::applyFixedScale(int32_t code, const ACS37800_FIXED_SCALE_t &scale)
+{
+  int64_t result = (int64_t)code * scale.multiplier;
+  if (scale.shift > 0)
+  {
+    result += ((int64_t)1) << (scale.shift - 1); // Round
+    result >>= scale.shift;
+  }
+  return ((int32_t)result);
+}
+
+//Start a configuration transaction: clear all staged changes
+void ACS37800::beginConfig(ACS37800_CONFIG_t *config)
+{
+  for (uint8_t i = 0; i < 5; i++)
+  {
+    config->value[i] = 0;
+    config->shadowMask[i] = 0;
+    config->eepromMask[i] = 0;
+  }
+}
+
+//Stage a change to the masked bits of a shadow (0x1B - 0x1F) or EEPROM (0x0B - 0x0F) register
+//Shadow and EEPROM share the staged value: a field staged for both gets the same value in both
+ACS37800ERR ACS37800::stageConfig(ACS37800_CONFIG_t *config, uint8_t address, uint32_t mask, uint32_t value)
+{
+  uint32_t *stagedMask;
+
+  if ((address >= ACS37800_REGISTER_SHADOW_1B) && (address <= ACS37800_REGISTER_SHADOW_1F))
+    stagedMask = &config->shadowMask[address - ACS37800_REGISTER_SHADOW_1B];
+  else if ((address >= ACS37800_REGISTER_EEPROM_0B) && (address <= ACS37800_REGISTER_EEPROM_0F))
+    stagedMask = &config->eepromMask[address - ACS37800_REGISTER_EEPROM_0B];
+  else
+    return (ACS37800_ERR_INVALID_REGISTER);
+
+  mask &= ACS37800_REGISTER_DATA_MASK; // Never touch the ECC bits
+  uint8_t index = (address & 0x0F) - 0x0B;
+  config->value[index] = (config->value[index] & ~mask) | (value & mask);
+  *stagedMask |= mask;
+  return (ACS37800_SUCCESS);
+}
+
+//Stage a change to the masked bits of a shadow register - and its EEPROM register too if _eeprom is true
+void ACS37800::stageMasked(ACS37800_CONFIG_t *config, uint8_t shadowAddress, uint32_t mask, uint32_t value, bool _eeprom)
+{
+  stageConfig(config, shadowAddress, mask, value);
+  if (_eeprom) // Check if user wants to set eeprom too
+    stageConfig(config, shadowAddress - 0x10, mask, value); // EEPROM is 0x10 below shadow
+}
+
+//Stage the number of samples for RMS calculations
+void ACS37800::stageNumberOfSamples(ACS37800_CONFIG_t *config, uint32_t numberOfSamples, bool _eeprom)
+{
+  stageField<ACS37800_FIELD_N>(config, numberOfSamples, _eeprom); //Adjust the number of samples (limited to 10 bits)
+}
+
+//Stage the Bypass_N_Enable flag
+void ACS37800::stageBypassNenable(ACS37800_CONFIG_t *config, bool bypass, bool _eeprom)
+{
+  stageField<ACS37800_FIELD_BYPASS_N_EN>(config, bypass ? 1 : 0, _eeprom); //Adjust bypass_n_en
+}
+
+//Stage the zero crossing channel, edge and output type
+void ACS37800::stageZeroCrossing(ACS37800_CONFIG_t *config, ACS37800_ZC_CHANNEL_e channel, ACS37800_ZC_EDGE_e edge, bool squareWave, bool _eeprom)
+{
+  stageField<ACS37800_FIELD_ZEROCROSSCHANSEL>(config, channel, _eeprom);
+  stageField<ACS37800_FIELD_ZEROCROSSEDGESEL>(config, edge, _eeprom);
+  stageField<ACS37800_FIELD_SQUAREWAVE_EN>(config, squareWave ? 1 : 0, _eeprom);
+}
+
+//Stage the iavgselen and pavgselen flags
+void ACS37800::stageAverageSelect(ACS37800_CONFIG_t *config, bool iavgselen, bool pavgselen, bool _eeprom)
+{
+  stageField<ACS37800_FIELD_IAVGSELEN>(config, iavgselen ? 1 : 0, _eeprom);
+  stageField<ACS37800_FIELD_PAVGSELEN>(config, pavgselen ? 1 : 0, _eeprom);
+}
+
+//Stage rms_avg_1 and rms_avg_2
+void ACS37800::stageAverageCounts(ACS37800_CONFIG_t *config, uint8_t rmsAvg1, uint16_t rmsAvg2, bool _eeprom)
+{
+  stageField<ACS37800_FIELD_RMS_AVG_1>(config, rmsAvg1, _eeprom); // Limited to 7 bits
+  stageField<ACS37800_FIELD_RMS_AVG_2>(config, rmsAvg2, _eeprom); // Limited to 10 bits
+}
+
+//Stage dio_0_sel and dio_1_sel
+void ACS37800::stageDIOFunctions(ACS37800_CONFIG_t *config, ACS37800_DIO0_FUNC_e dio0, ACS37800_DIO1_FUNC_e dio1, bool _eeprom)
+{
+  stageField<ACS37800_FIELD_DIO_0_SEL>(config, dio0, _eeprom);
+  stageField<ACS37800_FIELD_DIO_1_SEL>(config, dio1, _eeprom);
+}
+
+//Stage overvreg, undervreg and vevent_cycs
+void ACS37800::stageVoltageEvents(ACS37800_CONFIG_t *config, uint8_t overvreg, uint8_t undervreg, uint8_t veventCycles, bool _eeprom)
+{
+  stageField<ACS37800_FIELD_OVERVREG>(config, overvreg, _eeprom); // Limited to 6 bits
+  stageField<ACS37800_FIELD_UNDERVREG>(config, undervreg, _eeprom);
+  stageField<ACS37800_FIELD_VEVENT_CYCS>(config, veventCycles, _eeprom);
+}
+
+//Stage fault and fltdly
+void ACS37800::stageOvercurrentFault(ACS37800_CONFIG_t *config, uint8_t fault, ACS37800_FLTDLY_e delay, bool _eeprom)
+{
+  stageField<ACS37800_FIELD_FAULT>(config, fault, _eeprom);
+  stageField<ACS37800_FIELD_FLTDLY>(config, delay, _eeprom);
+}
+
+//Return the register address for configuration item 0-9. Items 0-4 are shadow 0x1B - 0x1F. Items 5-9 are EEPROM 0x0B - 0x0F.
+uint8_t ACS37800::configAddress(uint8_t item)
+{
+  return ((item < 5) ? ACS37800_REGISTER_SHADOW_1B + item : ACS37800_REGISTER_EEPROM_0B + item - 5);
+}
+
+//Return the staged mask for configuration item 0-9
+uint32_t ACS37800::configMask(const ACS37800_CONFIG_t *config, uint8_t item)
+{
+  return ((item < 5) ? config->shadowMask[item] : config->eepromMask[item - 5]);
+}
+
+//Return the first configuration item >= item which has changes staged. Returns 10 if there are none.
+uint8_t ACS37800::nextConfigItem(const ACS37800_CONFIG_t *config, uint8_t item)
+{
+  while ((item < 10) && (configMask(config, item) == 0))
+    item++;
+  return (item);
+}
+
+//Write all of the staged changes
+//The customer access code is written once, each register is read-modify-written once, and there is a single settle
+ACS37800ERR ACS37800::commitConfig(const ACS37800_CONFIG_t *config)
+{
+  ACS37800ERR error = writeRegister(ACS37800_CUSTOMER_ACCESS_CODE, ACS37800_REGISTER_VOLATILE_2F); // Set the customer access code
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("commitConfig: writeRegister (2F) returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  // Keep a note of what was written, so settle can check it
+  uint8_t settleAddresses[10];
+  uint32_t settleData[10];
+  uint8_t settleCount = 0;
+
+  for (uint8_t item = nextConfigItem(config, 0); item < 10; item = nextConfigItem(config, item + 1))
+  {
+    uint8_t address = configAddress(item);
+    uint32_t mask = configMask(config, item);
+    uint32_t store;
+    error = readConfigRegister(&store, address); // From the cache if possible
+
+    if (error != ACS37800_SUCCESS)
+    {
+      if (_printDebug == true)
+      {
+        _debugPort->print(F("commitConfig: readConfigRegister (0x"));
+        _debugPort->print(address, HEX);
+        _debugPort->print(F(") returned: "));
+        _debugPort->println(error);
+      }
+      return (error); // Bail
+    }
+
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("commitConfig: register 0x"));
+      _debugPort->print(address, HEX);
+      _debugPort->print(F(" is currently: 0x"));
+      _debugPort->println(store, HEX);
+    }
+
+    store = (store & ~mask) | (config->value[item % 5] & mask); // Modify the staged bits
+
+    error = writeRegister(store, address);
+
+    if (error != ACS37800_SUCCESS)
+    {
+      if (_printDebug == true)
+      {
+        _debugPort->print(F("commitConfig: writeRegister (0x"));
+        _debugPort->print(address, HEX);
+        _debugPort->print(F(") returned: "));
+        _debugPort->println(error);
+      }
+      return (error); // Bail
+    }
+
+    settleAddresses[settleCount] = address;
+    settleData[settleCount++] = store;
+  }
+
+  error = writeRegister(0, ACS37800_REGISTER_VOLATILE_2F); // Clear the customer access code
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("commitConfig: writeRegister (2F) returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  error = settle(settleAddresses, settleData, settleCount); // Allow time for the shadow/eeprom memory to be updated - otherwise the next readRegister will return zero...
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("commitConfig: settle returned: "));
+      _debugPort->println(error);
+    }
+  }
+
+  return (error);
+}
+
+//Enable or disable the shadow / EEPROM register cache. The cache starts empty: it fills as registers are read and written.
+//When enabled, the getters and commitConfig use the cached contents instead of re-reading 0x0B - 0x0F and 0x1B - 0x1F over I2C.
+void ACS37800::enableRegisterCache(bool enable)
+{
+  _cacheEnabled = enable;
+  invalidateRegisterCache();
+}
+
+//Discard the cached contents. Call this if the device is reset or reconfigured by something else.
+void ACS37800::invalidateRegisterCache()
+{
+  _cacheValid = 0;
+  _cacheDirty = 0;
+}
+
+//Re-read the cached registers from the device
+//If dirtyOnly is true, only the registers which have been written but not yet read back are re-read
+ACS37800ERR ACS37800::refreshRegisterCache(bool dirtyOnly)
+{
+  for (uint8_t item = 0; item < 10; item++)
+  {
+    if (dirtyOnly && ((_cacheDirty & (1 << item)) == 0))
+      continue;
+
+    uint8_t address = configAddress(item);
+    uint32_t store;
+    ACS37800ERR error = readRegister(&store, address);
+
+    if (error != ACS37800_SUCCESS)
+    {
+      if (_printDebug == true)
+      {
+        _debugPort->print(F("refreshRegisterCache: readRegister (0x"));
+        _debugPort->print(address, HEX);
+        _debugPort->print(F(") returned: "));
+        _debugPort->println(error);
+      }
+      return (error); // Bail
+    }
+
+    updateCache(address, store, false);
+  }
+
+  return (ACS37800_SUCCESS);
+}
+
+//Read a shadow or EEPROM register - from the cache if it is enabled and valid
+ACS37800ERR ACS37800::readConfigRegister(uint32_t *data, uint8_t address)
+{
+  uint8_t item = configItem(address);
+
+  if (_cacheEnabled && (item < 10) && (_cacheValid & (1 << item)))
+  {
+    *data = _cache[item];
+    return (ACS37800_SUCCESS);
+  }
+
+  ACS37800ERR error = readRegister(data, address);
+
+  if (error == ACS37800_SUCCESS)
+    updateCache(address, *data, false);
+
+  return (error);
+}
+
+//Update the cached copy of a shadow or EEPROM register (if the cache is enabled)
+//dirty indicates the contents have been written but not read back: the device may still be updating it,
+//and the ECC bits of an EEPROM register are not yet known
+void ACS37800::updateCache(uint8_t address, uint32_t data, bool dirty)
+{
+  uint8_t item = configItem(address);
+
+  if ((!_cacheEnabled) || (item >= 10))
+    return;
+
+  _cache[item] = data;
+  _cacheValid |= 1 << item;
+  if (dirty)
+    _cacheDirty |= 1 << item;
+  else
+    _cacheDirty &= ~(1 << item);
+}
+
+//Return the configuration item (0-9) for a shadow or EEPROM register address. Returns 10 for any other address.
+uint8_t ACS37800::configItem(uint8_t address)
+{
+  if ((address >= ACS37800_REGISTER_SHADOW_1B) && (address <= ACS37800_REGISTER_SHADOW_1F))
+    return (address - ACS37800_REGISTER_SHADOW_1B);
+  if ((address >= ACS37800_REGISTER_EEPROM_0B) && (address <= ACS37800_REGISTER_EEPROM_0F))
+    return (address - ACS37800_REGISTER_EEPROM_0B + 5);
+  return (10);
+}
+
+//Select how the setters wait for the shadow/eeprom memory to be updated after a write
+//ACS37800_SETTLE_FIXED_DELAY: wait for ACS37800_SETTLE_TIME_MS (the default)
+//ACS37800_SETTLE_POLL_READBACK: read the register back until the written value (and a valid ECC) appears, or timeoutMs expires
+void ACS37800::setSettlePolicy(ACS37800_SETTLE_POLICY_e policy, unsigned long timeoutMs)
+{
+  _settlePolicy = policy;
+  _settleTimeout = timeoutMs;
+}
+
+//Wait for the shadow/eeprom memory to be updated after writing data[i] to addresses[i]
+ACS37800ERR ACS37800::settle(const uint8_t *addresses, const uint32_t *data, uint8_t count)
+{
+  if (_settlePolicy == ACS37800_SETTLE_FIXED_DELAY)
+  {
+    delay(ACS37800_SETTLE_TIME_MS);
+    return (ACS37800_SUCCESS);
+  }
+
+  unsigned long startTime = millis();
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    while (true)
+    {
+      uint32_t readback;
+      ACS37800ERR error = readRegister(&readback, addresses[i]);
+
+      if (error != ACS37800_SUCCESS)
+        return (error); // Bail
+
+      unsigned long elapsed = millis() - startTime;
+
+      if (writeComplete(addresses[i], data[i], readback, elapsed))
+      {
+        updateCache(addresses[i], readback, false); // The cache (if enabled) now holds the confirmed contents
+        break; // This one is done. Check the next
+      }
+
+      if (settleExpired(data[i], elapsed))
+      {
+        if (_printDebug == true)
+        {
+          _debugPort->print(F("settle: timeout! register 0x"));
+          _debugPort->print(addresses[i], HEX);
+          _debugPort->print(F(" is 0x"));
+          _debugPort->println(readback, HEX);
+        }
+        reportError(ACS37800_ERR_SETTLE_TIMEOUT, addresses[i], 0);
+        return (ACS37800_ERR_SETTLE_TIMEOUT);
+      }
+
+      delay(1); // Don't hog the bus
+    }
+  }
+
+  return (ACS37800_SUCCESS);
+}
+
+//Returns true if readback shows that data has been written to address, elapsed ms after the write. Used by settle and checkAsync.
+//All of the data bits must match. The ECC bits are ignored - except for EEPROM, where they must show no error.
+//A register reads zero while it is being written, so a zero data word is only accepted once ACS37800_SETTLE_TIME_MS has passed
+bool ACS37800::writeComplete(uint8_t address, uint32_t data, uint32_t readback, unsigned long elapsed)
+{
+  if (((readback ^ data) & ACS37800_REGISTER_DATA_MASK) != 0)
+    return (false);
+
+  if ((address >= ACS37800_REGISTER_EEPROM_0B) && (address <= ACS37800_REGISTER_EEPROM_0F))
+  {
+    if ((readback & ~ACS37800_REGISTER_DATA_MASK) != 0) // ECC != ACS37800_EEPROM_ECC_NO_ERROR
+      return (false);
+  }
+
+  if ((data & ACS37800_REGISTER_DATA_MASK) == 0)
+    return (elapsed >= ACS37800_SETTLE_TIME_MS); // Can't tell it from a write in progress
+
+  return (true);
+}
+
+//Returns true if the settle has taken too long, elapsed ms after data was written. Used by settle and checkAsync.
+//A zero data word is always allowed ACS37800_SETTLE_TIME_MS (see writeComplete)
+bool ACS37800::settleExpired(uint32_t data, unsigned long elapsed)
+{
+  if (((data & ACS37800_REGISTER_DATA_MASK) == 0) && (elapsed < ACS37800_SETTLE_TIME_MS))
+    return (false);
+
+  return (elapsed >= _settleTimeout);
+}
+
+//Start an asynchronous register read. Use checkAsync to perform it. The contents are returned via the callback or getAsyncResult.
+ACS37800ERR ACS37800::startReadRegister(uint8_t address, ACS37800_ASYNC_CALLBACK callback, void *context)
+{
+  if (_asyncStep != ASYNC_STEP_IDLE)
+    return (ACS37800_ERR_ASYNC_BUSY);
+
+  _asyncAddress = address;
+  _asyncCallback = callback;
+  _asyncContext = context;
+  _asyncStep = ASYNC_STEP_READ;
+  return (ACS37800_SUCCESS);
+}
+
+//Start an asynchronous register write. Use checkAsync to perform it.
+//Note: there is no customer access code unlock and no settle time. Use the start set functions for that.
+ACS37800ERR ACS37800::startWriteRegister(uint32_t data, uint8_t address, ACS37800_ASYNC_CALLBACK callback, void *context)
+{
+  if (_asyncStep != ASYNC_STEP_IDLE)
+    return (ACS37800_ERR_ASYNC_BUSY);
+
+  _asyncAddress = address;
+  _asyncData = data;
+  _asyncCallback = callback;
+  _asyncContext = context;
+  _asyncStep = ASYNC_STEP_WRITE;
+  return (ACS37800_SUCCESS);
+}
+
+//Start an asynchronous update of the number of samples. The non-blocking equivalent of setNumberOfSamples.
+ACS37800ERR ACS37800::startSetNumberOfSamples(uint32_t numberOfSamples, bool _eeprom, ACS37800_ASYNC_CALLBACK callback, void *context)
+{
+  ACS37800_CONFIG_t config;
+  beginConfig(&config);
+  stageNumberOfSamples(&config, numberOfSamples, _eeprom);
+  return (startCommitConfig(&config, callback, context));
+}
+
+//Start an asynchronous update of the Bypass_N_Enable flag. The non-blocking equivalent of setBypassNenable.
+ACS37800ERR ACS37800::startSetBypassNenable(bool bypass, bool _eeprom, ACS37800_ASYNC_CALLBACK callback, void *context)
+{
+  ACS37800_CONFIG_t config;
+  beginConfig(&config);
+  stageBypassNenable(&config, bypass, _eeprom);
+  return (startCommitConfig(&config, callback, context));
+}
+
+//Start an asynchronous commit of the staged configuration changes. The non-blocking equivalent of commitConfig.
+//config is copied, so it does not need to persist.
+ACS37800ERR ACS37800::startCommitConfig(const ACS37800_CONFIG_t *config, ACS37800_ASYNC_CALLBACK callback, void *context)
+{
+  if (_asyncStep != ASYNC_STEP_IDLE)
+    return (ACS37800_ERR_ASYNC_BUSY);
+
+  _asyncConfig = *config;
+  _asyncData = 0;
+  _asyncCallback = callback;
+  _asyncContext = context;
+  _asyncStep = ASYNC_STEP_UNLOCK;
+  return (ACS37800_SUCCESS);
+}
+
+//Advance the asynchronous operation by (at most) one I2C transaction
+//Returns ACS37800_ASYNC_COMPLETE when the operation finishes. The callback (if any) has been called by then.
+ACS37800_ASYNC_STATUS_e ACS37800::checkAsync()
+{
+  ACS37800ERR error = ACS37800_SUCCESS;
+
+  switch (_asyncStep)
+  {
+    case ASYNC_STEP_IDLE:
+      return (ACS37800_ASYNC_IDLE);
+
+    case ASYNC_STEP_READ:
+      error = readRegister(&_asyncData, _asyncAddress);
+      finishAsync(error);
+      return (ACS37800_ASYNC_COMPLETE);
+
+    case ASYNC_STEP_WRITE:
+      error = writeRegister(_asyncData, _asyncAddress);
+      finishAsync(error);
+      return (ACS37800_ASYNC_COMPLETE);
+
+    case ASYNC_STEP_UNLOCK:
+      error = writeRegister(ACS37800_CUSTOMER_ACCESS_CODE, ACS37800_REGISTER_VOLATILE_2F); // Set the customer access code
+      _asyncItem = nextConfigItem(&_asyncConfig, 0);
+      _asyncStep = (_asyncItem < 10) ? ASYNC_STEP_CONFIG_READ : ASYNC_STEP_LOCK;
+      break;
+
+    case ASYNC_STEP_CONFIG_READ:
+    {
+      uint32_t mask = configMask(&_asyncConfig, _asyncItem);
+      error = readConfigRegister(&_asyncWord, configAddress(_asyncItem)); // Read the register - from the cache if possible
+      _asyncWord = (_asyncWord & ~mask) | (_asyncConfig.value[_asyncItem % 5] & mask); // Modify the staged bits
+      _asyncStep = ASYNC_STEP_CONFIG_WRITE;
+    }
+      break;
+
+    case ASYNC_STEP_CONFIG_WRITE:
+      error = writeRegister(_asyncWord, configAddress(_asyncItem)); // Write the register
+      _asyncWritten[_asyncItem] = _asyncWord; // Keep the whole word for the settle
+      _asyncItem = nextConfigItem(&_asyncConfig, _asyncItem + 1);
+      _asyncStep = (_asyncItem < 10) ? ASYNC_STEP_CONFIG_READ : ASYNC_STEP_LOCK;
+      break;
+
+    case ASYNC_STEP_LOCK:
+      error = writeRegister(0, ACS37800_REGISTER_VOLATILE_2F); // Clear the customer access code
+      _asyncTimer = millis();
+      _asyncItem = nextConfigItem(&_asyncConfig, 0); // With ACS37800_SETTLE_POLL_READBACK, check each register in turn
+      _asyncStep = ASYNC_STEP_SETTLE;
+      break;
+
+    case ASYNC_STEP_SETTLE:
+      if (_settlePolicy == ACS37800_SETTLE_FIXED_DELAY)
+      {
+        if (millis() - _asyncTimer >= ACS37800_SETTLE_TIME_MS) // Allow time for the shadow/eeprom memory to be updated
+        {
+          finishAsync(ACS37800_SUCCESS);
+          return (ACS37800_ASYNC_COMPLETE);
+        }
+      }
+      else if (_asyncItem >= 10)
+      {
+        finishAsync(ACS37800_SUCCESS); // All registers have been checked
+        return (ACS37800_ASYNC_COMPLETE);
+      }
+      else
+      {
+        // The same checks as settle: the whole word written - and the ECC for EEPROM
+        uint32_t readback;
+        uint8_t address = configAddress(_asyncItem);
+        error = readRegister(&readback, address);
+        unsigned long elapsed = millis() - _asyncTimer;
+        if ((error == ACS37800_SUCCESS) && writeComplete(address, _asyncWritten[_asyncItem], readback, elapsed))
+        {
+          updateCache(address, readback, false); // The cache (if enabled) now holds the confirmed contents
+          _asyncItem = nextConfigItem(&_asyncConfig, _asyncItem + 1); // This one is done. Check the next
+        }
+        else if ((error == ACS37800_SUCCESS) && settleExpired(_asyncWritten[_asyncItem], elapsed))
+        {
+          error = ACS37800_ERR_SETTLE_TIMEOUT;
+          reportError(error, address, 0);
+        }
+      }
+      break;
+  }
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("checkAsync: failed! error is: "));
+      _debugPort->println(error);
+    }
+    finishAsync(error); // Bail
+    return (ACS37800_ASYNC_COMPLETE);
+  }
+
+  return (ACS37800_ASYNC_BUSY);
+}
+
+//Returns true if an asynchronous operation is in progress
+bool ACS37800::isAsyncBusy()
+{
+  return (_asyncStep != ASYNC_STEP_IDLE);
+}
+
+//Return the result of the last completed asynchronous operation.
+//For startReadRegister, the register contents are returned in data.
+ACS37800ERR ACS37800::getAsyncResult(uint32_t *data)
+{
+  if (data != NULL)
+    *data = _asyncData;
+  return (_asyncResult);
+}
+
+//End the asynchronous operation: store the result and call the callback
+void ACS37800::finishAsync(ACS37800ERR result)
+{
+  _asyncStep = ASYNC_STEP_IDLE;
+  _asyncResult = result;
+  if (_asyncCallback != NULL)
+    _asyncCallback(result, _asyncData, _asyncContext);
+}
+
+//Capture count instantaneous samples into buffer. Bail on the first error.
+ACS37800ERR ACS37800::captureInstantaneous(ACS37800WaveformBuffer &buffer, uint16_t count, bool includePower)
+{
+  for (uint16_t i = 0; i < count; i++)
+  {
+    ACS37800_WAVEFORM_SAMPLE_t sample;
+    ACS37800ERR error = readSample(&sample, includePower);
+
+    if (error != ACS37800_SUCCESS)
+      return (error); // Bail
+
+    buffer.push(sample);
+  }
+
+  return (ACS37800_SUCCESS);
+}
+
+//Capture whole voltage cycles into buffer
+//The sample which follows a rising zero crossing starts a cycle. Sampling stops when the zero crossing at the end of the last cycle is seen.
+ACS37800ERR ACS37800::captureCycles(ACS37800WaveformBuffer &buffer, uint8_t cycles, ACS37800_ZC_SOURCE_e source, bool includePower, unsigned long timeoutMs)
+{
+  buffer.clear();
+
+  noInterrupts();
+  _zeroCrossings = 0; // Ignore any earlier interrupts
+  interrupts();
+
+  uint16_t crossings = 0; // The number of zero crossings seen so far. Wider than cycles, so crossings > cycles is possible for 255
+  bool armed = false; // For ACS37800_ZC_SOURCE_SOFTWARE and _POLL_2D: a negative half cycle has been seen
+  unsigned long lastCrossing = millis();
+  unsigned long lastCrossingMicros = 0; // For ACS37800_ZC_SOURCE_SOFTWARE: the time of the last rising crossing
+
+  while (true)
+  {
+    bool crossed = false;
+    ACS37800ERR error;
+
+    if (source == ACS37800_ZC_SOURCE_POLL_2D)
+    {
+      uint32_t flags;
+      error = readRegister(&flags, ACS37800_REGISTER_VOLATILE_2D); // Read register 2D
+
+      if (error != ACS37800_SUCCESS)
+      {
+        if (_printDebug == true)
+        {
+          _debugPort->print(F("captureCycles: readRegister (2D) returned: "));
+          _debugPort->println(error);
+        }
+        return (error); // Bail
+      }
+
+      if (ACS37800_FIELD_VZEROCROSSOUT::extract(flags) == 0)
+        armed = true;
+      else if (armed)
+      {
+        crossed = true; // Rising edge
+        armed = false;
+      }
+    }
+    else if (source == ACS37800_ZC_SOURCE_INTERRUPT)
+    {
+      noInterrupts();
+      crossed = (_zeroCrossings > 0);
+      _zeroCrossings = 0;
+      interrupts();
+    }
+
+    ACS37800_WAVEFORM_SAMPLE_t sample;
+    error = readSample(&sample, includePower);
+
+    if (error != ACS37800_SUCCESS)
+      return (error); // Bail
+
+    if (source == ACS37800_ZC_SOURCE_SOFTWARE)
+    {
+      if (sample.vCodes < -ACS37800_ZC_HYSTERESIS)
+        armed = true;
+      else if (armed && (sample.vCodes >= 0))
+      {
+        armed = false;
+        unsigned long now = micros();
+        if ((crossings == 0) || (now - lastCrossingMicros >= ACS37800_ZC_MIN_PERIOD)) // Otherwise it is noise
+        {
+          crossed = true; // This sample is the first of the positive half cycle
+          lastCrossingMicros = now;
+        }
+      }
+    }
+
+    if (crossed)
+    {
+      crossings++;
+      lastCrossing = millis();
+      if (crossings > cycles)
+        return (ACS37800_SUCCESS); // All done. This sample belongs to the next cycle
+    }
+    else if (millis() - lastCrossing >= timeoutMs)
+    {
+      if (_printDebug == true)
+      {
+        _debugPort->print(F("captureCycles: zero crossing timeout! crossings: "));
+        _debugPort->println(crossings);
+      }
+      return (ACS37800_ERR_ZERO_CROSSING_TIMEOUT);
+    }
+
+    if (crossings > 0) // Sampling has started
+    {
+      if (buffer.available() >= buffer.getSize())
+      {
+        if (_printDebug == true)
+          _debugPort->println(F("captureCycles: buffer full!"));
+        return (ACS37800_ERR_BUFFER_FULL);
+      }
+      buffer.push(sample);
+    }
+  }
+}
+
+//Record a zero crossing. Call this from the DIO_0 interrupt routine.
+void ACS37800::notifyZeroCrossing()
+{
+  if (_zeroCrossings < 255)
+    _zeroCrossings++;
+}
+
+//The objects using interrupts, by slot
+ACS37800 *ACS37800::_interruptDevices[ACS37800_MAX_EVENT_DEVICES] = { NULL, NULL, NULL, NULL };
+
+//Arm interrupts on the MCU pins connected to DIO_0 and DIO_1. Use -1 for a pin which is not connected.
+ACS37800ERR ACS37800::attachEventInterrupts(int dio0Pin, int dio1Pin, ACS37800_EVENT_CALLBACK callback, void *context,
+                                            ACS37800_INTERRUPT_MODE_t mode)
+{
+  if ((dio0Pin >= 0) && (dio0Pin == dio1Pin))
+  {
+    if (_printDebug == true)
+      _debugPort->println(F("attachEventInterrupts: DIO_0 and DIO_1 are on the same pin!"));
+    return (ACS37800_ERR_INTERRUPT_UNAVAILABLE);
+  }
+
+  ACS37800ERR error = checkInterruptPin(dio0Pin, true);
+  if (error == ACS37800_SUCCESS)
+    error = checkInterruptPin(dio1Pin, true);
+  if (error == ACS37800_SUCCESS)
+    error = allocateInterruptSlot();
+  if (error != ACS37800_SUCCESS)
+    return (error); // Bail
+
+  void (*isr)() = NULL;
+  switch (_interruptSlot)
+  {
+    case 0: isr = eventISR0; break;
+    case 1: isr = eventISR1; break;
+    case 2: isr = eventISR2; break;
+    default: isr = eventISR3; break;
+  }
+
+  _eventCallback = callback;
+  _eventContext = context;
+  _eventPending = true; // Read 0x2D on the first checkEvents, in case an event is already active
+
+  int pins[2] = { dio0Pin, dio1Pin };
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    if (_eventPins[i] >= 0)
+      detachInterrupt(digitalPinToInterrupt(_eventPins[i])); // Detach any previous pin
+    _eventPins[i] = pins[i];
+    if (pins[i] >= 0)
+      attachInterrupt(digitalPinToInterrupt(pins[i]), isr, mode);
+  }
+
+  return (ACS37800_SUCCESS);
+}
+
+//Read 0x2D - but only if an interrupt has fired since the last call - and pass the flags to the callback
+ACS37800ERR ACS37800::checkEvents()
+{
+  noInterrupts();
+  bool pending = _eventPending;
+  _eventPending = false;
+  interrupts();
+
+  if (!pending)
+    return (ACS37800_SUCCESS); // Nothing to do
+
+  ACS37800_REGISTER_2D_t flags;
+  ACS37800ERR error = readRegister(&flags.data.all, ACS37800_REGISTER_VOLATILE_2D); // Read register 2D
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("checkEvents: readRegister (2D) returned: "));
+      _debugPort->println(error);
+    }
+    _eventPending = true; // Try again next time
+    return (error); // Bail
+  }
+
+  if (_eventCallback != NULL)
+    _eventCallback(flags, _eventContext);
+
+  return (ACS37800_SUCCESS);
+}
+
+//Clear the latched overcurrent fault: write 1 to faultlatched in 0x2D
+ACS37800ERR ACS37800::clearFaultLatch()
+{
+  ACS37800ERR error = writeRegister(ACS37800_FIELD_FAULTLATCHED::insert(0, 1), ACS37800_REGISTER_VOLATILE_2D); // Write register 2D
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("clearFaultLatch: writeRegister (2D) returned: "));
+      _debugPort->println(error);
+    }
+  }
+
+  return (error);
+}
+
+//Arm an interrupt on the MCU pin connected to DIO_0. The interrupt routine calls notifyZeroCrossing.
+ACS37800ERR ACS37800::attachZeroCrossingInterrupt(int dio0Pin, ACS37800_INTERRUPT_MODE_t mode)
+{
+  if (dio0Pin < 0)
+    return (ACS37800_ERR_INTERRUPT_UNAVAILABLE); // Bail
+
+  ACS37800ERR error = checkInterruptPin(dio0Pin, false);
+  if (error == ACS37800_SUCCESS)
+    error = allocateInterruptSlot();
+  if (error != ACS37800_SUCCESS)
+    return (error); // Bail
+
+  void (*isr)() = NULL;
+  switch (_interruptSlot)
+  {
+    case 0: isr = zeroCrossingISR0; break;
+    case 1: isr = zeroCrossingISR1; break;
+    case 2: isr = zeroCrossingISR2; break;
+    default: isr = zeroCrossingISR3; break;
+  }
+
+  if (_zeroCrossingPin >= 0)
+    detachInterrupt(digitalPinToInterrupt(_zeroCrossingPin)); // Detach any previous pin
+  _zeroCrossingPin = dio0Pin;
+  attachInterrupt(digitalPinToInterrupt(dio0Pin), isr, mode);
+
+  return (ACS37800_SUCCESS);
+}
+
+//Detach all of the interrupts armed by this object and free its slot
+void ACS37800::detachInterrupts()
+{
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    if (_eventPins[i] >= 0)
+      detachInterrupt(digitalPinToInterrupt(_eventPins[i]));
+    _eventPins[i] = -1;
+  }
+
+  if (_zeroCrossingPin >= 0)
+    detachInterrupt(digitalPinToInterrupt(_zeroCrossingPin));
+  _zeroCrossingPin = -1;
+
+  if (_interruptSlot >= 0)
+    _interruptDevices[_interruptSlot] = NULL;
+  _interruptSlot = -1;
+}
+
+//Find a free slot in _interruptDevices for this object (if it does not have one already)
+ACS37800ERR ACS37800::allocateInterruptSlot()
+{
+  if (_interruptSlot >= 0)
+    return (ACS37800_SUCCESS); // Already allocated
+
+  for (uint8_t slot = 0; slot < ACS37800_MAX_EVENT_DEVICES; slot++)
+  {
+    if (_interruptDevices[slot] == NULL)
+    {
+      _interruptDevices[slot] = this;
+      _interruptSlot = slot;
+      return (ACS37800_SUCCESS);
+    }
+  }
+
+  if (_printDebug == true)
+    _debugPort->println(F("allocateInterruptSlot: all slots are in use!"));
+  return (ACS37800_ERR_INTERRUPT_UNAVAILABLE);
+}
+
+//Check that pin (if connected) has an interrupt, and that it is not already armed:
+//by another object, or by this object for the other purpose (forEvents is true for events, false for zero crossing).
+//attachInterrupt has one routine per pin, so a second attach would silently replace the first.
+ACS37800ERR ACS37800::checkInterruptPin(int pin, bool forEvents)
+{
+  if (pin < 0)
+    return (ACS37800_SUCCESS); // Not connected
+
+#ifdef NOT_AN_INTERRUPT
+  if (digitalPinToInterrupt(pin) == NOT_AN_INTERRUPT)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("checkInterruptPin: pin "));
+      _debugPort->print(pin);
+      _debugPort->println(F(" has no interrupt!"));
+    }
+    return (ACS37800_ERR_INTERRUPT_UNAVAILABLE);
+  }
+#endif
+
+  bool inUse = forEvents ? (pin == _zeroCrossingPin) : ((pin == _eventPins[0]) || (pin == _eventPins[1]));
+  for (uint8_t slot = 0; slot < ACS37800_MAX_EVENT_DEVICES; slot++)
+  {
+    ACS37800 *device = _interruptDevices[slot];
+    if ((device != NULL) && (device != this))
+      inUse |= (pin == device->_zeroCrossingPin) || (pin == device->_eventPins[0]) || (pin == device->_eventPins[1]);
+  }
+
+  if (inUse)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("checkInterruptPin: pin "));
+      _debugPort->print(pin);
+      _debugPort->println(F(" is already in use!"));
+    }
+    return (ACS37800_ERR_INTERRUPT_UNAVAILABLE);
+  }
+
+  return (ACS37800_SUCCESS);
+}
+
+//The interrupt routines. Keep these short!
+void ACS37800::eventISR(uint8_t slot)
+{
+  if (_interruptDevices[slot] != NULL)
+    _interruptDevices[slot]->_eventPending = true;
+}
+
+void ACS37800::eventISR0() { eventISR(0); }
+void ACS37800::eventISR1() { eventISR(1); }
+void ACS37800::eventISR2() { eventISR(2); }
+void ACS37800::eventISR3() { eventISR(3); }
+
+void ACS37800::zeroCrossingISR(uint8_t slot)
+{
+  if (_interruptDevices[slot] != NULL)
+    _interruptDevices[slot]->notifyZeroCrossing();
+}
+
+void ACS37800::zeroCrossingISR0() { zeroCrossingISR(0); }
+void ACS37800::zeroCrossingISR1() { zeroCrossingISR(1); }
+void ACS37800::zeroCrossingISR2() { zeroCrossingISR(2); }
+void ACS37800::zeroCrossingISR3() { zeroCrossingISR(3); }
+
+//Read one waveform sample: 0x2A and (if includePower is true) 0x2C
+ACS37800ERR ACS37800::readSample(ACS37800_WAVEFORM_SAMPLE_t *sample, bool includePower)
+{
+  uint32_t store;
+  sample->timestamp = micros();
+  ACS37800ERR error = readRegister(&store, ACS37800_REGISTER_VOLATILE_2A); // Read register 2A
+
+  if (error != ACS37800_SUCCESS)
+  {
+    if (_printDebug == true)
+    {
+      _debugPort->print(F("readSample: readRegister (2A) returned: "));
+      _debugPort->println(error);
+    }
+    return (error); // Bail
+  }
+
+  sample->vCodes = ACS37800_FIELD_VCODES::extract(store);
+  sample->iCodes = ACS37800_FIELD_ICODES::extract(store);
+  sample->pCodes = 0;
+
+  if (includePower)
+  {
+    uint32_t pstore;
+    error = readRegister(&pstore, ACS37800_REGISTER_VOLATILE_2C); // Read register 2C
+
+    if (error != ACS37800_SUCCESS)
+    {
+      if (_printDebug == true)
+      {
+        _debugPort->print(F("readSample: readRegister (2C) returned: "));
+        _debugPort->println(error);
+      }
+      return (error); // Bail
+    }
+
+    sample->pCodes = ACS37800_FIELD_PINSTANT::extract(pstore);
+  }
+
+  return (ACS37800_SUCCESS);
+}
+
+ACS37800WaveformBuffer::ACS37800WaveformBuffer(ACS37800_WAVEFORM_SAMPLE_t *storage, uint16_t size)
+{
+  _storage = storage;
+  _size = size;
+}
+
+//Add a sample. If the buffer is full, the oldest sample is overwritten.
+void ACS37800WaveformBuffer::push(const ACS37800_WAVEFORM_SAMPLE_t &sample)
+{
+  if (_size == 0)
+    return;
+
+  _storage[_head] = sample;
+  _head++;
+  if (_head >= _size)
+    _head = 0;
+
+  if (_count < _size)
+    _count++;
+  else
+    _overruns++; // The oldest sample has been overwritten
+}
+
+//Remove the oldest sample. Returns false if the buffer is empty.
+bool ACS37800WaveformBuffer::pop(ACS37800_WAVEFORM_SAMPLE_t *sample)
+{
+  if (!peek(0, sample))
+    return (false);
+
+  _count--;
+  return (true);
+}
+
+//Copy sample index (0 is the oldest) without removing it. Returns false if index is invalid.
+bool ACS37800WaveformBuffer::peek(uint16_t index, ACS37800_WAVEFORM_SAMPLE_t *sample)
+{
+  if (index >= _count)
+    return (false);
+
+  uint32_t position = (uint32_t)_head + _size - _count + index; // The oldest sample is _count behind _head
+  *sample = _storage[position % _size];
+  return (true);
+}
+
+//Return the number of samples in the buffer
+uint16_t ACS37800WaveformBuffer::available()
+{
+  return (_count);
+}
+
+//Return the capacity of the buffer
+uint16_t ACS37800WaveformBuffer::getSize()
+{
+  return (_size);
+}
+
+//Return the number of samples which were overwritten before they were popped
+uint32_t ACS37800WaveformBuffer::getOverruns()
+{
+  return (_overruns);
+}
+
+//Empty the buffer and reset the overrun count
+void ACS37800WaveformBuffer::clear()
+{
+  _head = 0;
+  _count = 0;
+  _overruns = 0;
+}
+
+//Analyze channel of the samples in buffer
+bool ACS37800HarmonicAnalyzer::analyze(ACS37800WaveformBuffer &buffer, uint8_t cycles, ACS37800_WAVEFORM_CHANNEL_e channel,
+                                       ACS37800_HARMONICS_t *result, uint8_t harmonics)
+{
+  GOERTZEL_t filters;
+  uint16_t count = buffer.available();
+
+  if (!begin(&filters, count, cycles, harmonics))
+  {
+    result->harmonics = 0;
+    result->thd = 0;
+    return (false);
+  }
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    ACS37800_WAVEFORM_SAMPLE_t sample;
+    buffer.peek(i, &sample);
+    if (channel == ACS37800_WAVEFORM_VOLTAGE)
+      update(&filters, sample.vCodes);
+    else if (channel == ACS37800_WAVEFORM_CURRENT)
+      update(&filters, sample.iCodes);
+    else
+      update(&filters, sample.pCodes);
+  }
+
+  return (finish(&filters, count, result));
+}
+
+//Analyze an array of samples
+bool ACS37800HarmonicAnalyzer::analyze(const int16_t *samples, uint16_t count, uint8_t cycles,
+                                       ACS37800_HARMONICS_t *result, uint8_t harmonics)
+{
+  GOERTZEL_t filters;
+
+  if (!begin(&filters, count, cycles, harmonics))
+  {
+    result->harmonics = 0;
+    result->thd = 0;
+    return (false);
+  }
+
+  for (uint16_t i = 0; i < count; i++)
+    update(&filters, samples[i]);
+
+  return (finish(&filters, count, result));
+}
+
+//Calculate the filter coefficients and clear the states
+//Harmonic h of a block containing cycles cycles is at DFT bin (h * cycles)
+//Harmonics at or above the Nyquist frequency (count / 2) are skipped
+bool ACS37800HarmonicAnalyzer::begin(GOERTZEL_t *filters, uint16_t count, uint8_t cycles, uint8_t harmonics)
+{
+  if (harmonics > ACS37800_MAX_HARMONICS)
+    harmonics = ACS37800_MAX_HARMONICS;
+
+  filters->harmonics = 0;
+
+  for (uint8_t h = 0; h < harmonics; h++)
+  {
+    uint32_t bin = (uint32_t)(h + 1) * cycles;
+    if ((bin * 2) >= count)
+      break; // Above Nyquist
+
+    sinCosQ30(bin, count, &filters->cosQ30[h], &filters->sinQ30[h]);
+    filters->s1[h] = 0;
+    filters->s2[h] = 0;
+    filters->harmonics++;
+  }
+
+  return (filters->harmonics > 0);
+}
+
+//Feed one sample into every filter: s = x + 2cos(w).s1 - s2
+void ACS37800HarmonicAnalyzer::update(GOERTZEL_t *filters, int16_t sample)
+{
+  for (uint8_t h = 0; h < filters->harmonics; h++)
+  {
+    int64_t s0 = (int64_t)sample + (mulQ30(filters->cosQ30[h], filters->s1[h]) * 2) - filters->s2[h];
+    filters->s2[h] = filters->s1[h];
+    filters->s1[h] = s0;
+  }
+}
+
+//Calculate the magnitudes and the THD
+bool ACS37800HarmonicAnalyzer::finish(GOERTZEL_t *filters, uint16_t count, ACS37800_HARMONICS_t *result)
+{
+  result->harmonics = filters->harmonics;
+
+  uint64_t harmonicPower = 0; // The sum of the squares of harmonics 2 and above
+
+  for (uint8_t h = 0; h < filters->harmonics; h++)
+  {
+    int64_t re = filters->s1[h] - mulQ30(filters->cosQ30[h], filters->s2[h]);
+    int64_t im = mulQ30(filters->sinQ30[h], filters->s2[h]);
+
+    // Scale re and im down (if needed) so their squares cannot overflow
+    uint8_t shift = 0;
+    while ((re > 0x3FFFFFFF) || (re < -0x3FFFFFFF) || (im > 0x3FFFFFFF) || (im < -0x3FFFFFFF))
+    {
+      re >>= 1;
+      im >>= 1;
+      shift++;
+    }
+
+    uint64_t dft = sqrt64((uint64_t)(re * re) + (uint64_t)(im * im)) << shift; // |X(k)|
+    uint32_t magnitude = (uint32_t)((dft * 2) / count); // Peak amplitude
+    result->magnitude[h] = magnitude;
+
+    if (h > 0)
+      harmonicPower += (uint64_t)magnitude * magnitude;
+  }
+
+  for (uint8_t h = filters->harmonics; h < ACS37800_MAX_HARMONICS; h++)
+    result->magnitude[h] = 0;
+
+  if (result->magnitude[0] == 0)
+  {
+    result->thd = 0;
+    return (false);
+  }
+
+  result->thd = (uint32_t)((sqrt64(harmonicPower) * 10000) / result->magnitude[0]);
+  return (true);
+}
+
+//Calculate cos(w) and sin(w) in Q30 format, where w = 2.pi.bin / count (0 <= w < pi)
+//Integer Taylor series, accurate to a few LSBs. (double is only 32 bits on AVR: cos(w) * 2^30 would be good to about 24 bits)
+void ACS37800HarmonicAnalyzer::sinCosQ30(uint32_t bin, uint16_t count, int32_t *cosQ30, int32_t *sinQ30)
+{
+  const int64_t ONE = (int64_t)1 << 30;
+  const int64_t PI_Q30 = 3373259426LL; // pi in Q30
+  const int64_t TWO_PI_Q32 = 26986075409LL; // 2.pi in Q32
+
+  int64_t w = (((int64_t)bin * TWO_PI_Q32) / count + 2) >> 2; // Q30
+
+  bool reflect = false; // cos(pi - w) = -cos(w), sin(pi - w) = sin(w). Keeps w <= pi/2 so the series converges quickly
+  if (w > PI_Q30 / 2)
+  {
+    w = PI_Q30 - w;
+    reflect = true;
+  }
+
+  int64_t w2 = (w * w + (ONE / 2)) >> 30;
+  int64_t c = ONE;
+  int64_t s = w;
+  int64_t cTerm = ONE;
+  int64_t sTerm = w;
+
+  for (int64_t k = 2; k <= 16; k += 2) // The next terms (w^18 / 18!, w^19 / 19!) are below 1 LSB for w <= pi/2
+  {
+    cTerm = -((cTerm * w2) / ((k - 1) * k * ONE));
+    sTerm = -((sTerm * w2) / (k * (k + 1) * ONE));
+    c += cTerm;
+    s += sTerm;
+  }
+
+  *cosQ30 = (int32_t)(reflect ? -c : c);
+  *sinQ30 = (int32_t)s;
+}
+
+//Return (a * b) >> 30, where a is Q30. b is split into two parts so neither product can overflow.
+int64_t ACS37800HarmonicAnalyzer::mulQ30(int32_t a, int64_t b)
+{
+  int64_t high = b >> 15; // Arithmetic shift: keeps the sign
+  int64_t low = b & 0x7FFF; // Always positive
+  return (((a * high) >> 15) + ((a * low) >> 30));
+}
+
+//Return the integer square root of value
+uint64_t ACS37800HarmonicAnalyzer::sqrt64(uint64_t value)
+{
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while (bit > value)
+    bit >>= 2;
+
+  while (bit != 0)
+  {
+    if (value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+      root >>= 1;
+    bit >>= 2;
+  }
+
+  return (root);
+}
+
+//Read 0x21 and 0x22 and integrate the power since the previous update
+ACS37800ERR ACS37800EnergyMeter::update(ACS37800 &sensor)
+{
+  uint32_t reg21Data, reg22Data;
+  ACS37800ERR error = sensor.readRegister(&reg21Data, ACS37800_REGISTER_VOLATILE_21); // Read register 21
+  if (error == ACS37800_SUCCESS)
+    error = sensor.readRegister(&reg22Data, ACS37800_REGISTER_VOLATILE_22); // Read register 22
+
+  if (error != ACS37800_SUCCESS)
+    return (error); // Bail. The next successful update covers the missed interval
+
+  accumulate(reg21Data, reg22Data, millis());
+  return (ACS37800_SUCCESS);
+}
+
+//Integrate the contents of registers 0x21 and 0x22, read at timestamp
+//The ACS37800 averages the power over the previous n samples, so each reading is applied to the interval which ends at timestamp
+void ACS37800EnergyMeter::accumulate(uint32_t reg21Data, uint32_t reg22Data, unsigned long timestamp)
+{
+  if (!_started)
+  {
+    _lastTimestamp = timestamp; // Start the clock
+    _started = true;
+    return;
+  }
+
+  uint32_t elapsed = timestamp - _lastTimestamp; // Unsigned subtraction copes with the millis() roll-over
+  _lastTimestamp = timestamp;
+
+  int32_t pactive = ACS37800_FIELD_PACTIVE::extract(reg21Data); // pactive is signed
+  if (pactive < 0)
+    pactive = 0 - pactive;
+
+  if (ACS37800_FIELD_POSPF::extract(reg22Data)) // pospf indicates the direction
+    _totals.activeImport += (int64_t)pactive * elapsed;
+  else
+    _totals.activeExport += (int64_t)pactive * elapsed;
+
+  _totals.reactive += (int64_t)ACS37800_FIELD_PIMAG::extract(reg21Data) * elapsed;
+  _totals.apparent += (int64_t)ACS37800_FIELD_PAPPARENT::extract(reg22Data) * elapsed;
+  _totals.elapsedMs += elapsed;
+}
+
+//Return the raw totals
+void ACS37800EnergyMeter::getRaw(ACS37800_ENERGY_RAW_t *raw)
+{
+  *raw = _totals;
+}
+
+//Restore the raw totals. The clock restarts on the next update.
+void ACS37800EnergyMeter::setRaw(const ACS37800_ENERGY_RAW_t &raw)
+{
+  _totals = raw;
+  _started = false;
+}
+
+//Clear the totals. The clock restarts on the next update.
+void ACS37800EnergyMeter::reset()
+{
+  _totals.activeImport = 0;
+  _totals.activeExport = 0;
+  _totals.reactive = 0;
+  _totals.apparent = 0;
+  _totals.elapsedMs = 0;
+  _started = false;
+}
+
+//Convert the totals to Wh / VARh / VAh
+void ACS37800EnergyMeter::getEnergy(const ACS37800_CALIBRATION_t &calibration, ACS37800_ENERGY_t *energy)
+{
+  const double msPerHour = 3600000.0;
+  energy->importWh = (double)_totals.activeImport * calibration.wattsPerCode / msPerHour;
+  energy->exportWh = (double)_totals.activeExport * calibration.wattsPerCode / msPerHour;
+  energy->VARh = (double)_totals.reactive * calibration.varPerCode / msPerHour;
+  energy->VAh = (double)_totals.apparent * calibration.vaPerCode / msPerHour;
+}
+
+//Set the deadband for one quantity (codes, and per mille of the last reported code)
+void ACS37800Deadband::setDeadband(ACS37800_DEADBAND_QUANTITY_e quantity, uint16_t absoluteCodes, uint16_t relativePerMille)
+{
+  if (quantity > ACS37800_DEADBAND_PACTIVE)
+    return;
+  _absolute[quantity] = absoluteCodes;
+  _relative[quantity] = relativePerMille;
+}
+
+//Report everything if nothing has been reported for maxSilenceMs (0 = never)
+void ACS37800Deadband::setHeartbeat(unsigned long maxSilenceMs)
+{
+  _maxSilence = maxSilenceMs;
+}
+
+//Report everything on the next check
+void ACS37800Deadband::reset()
+{
+  _started = false;
+}
+
+//Read 0x20 and 0x21. Decode them only if something needs to be reported
+ACS37800ERR ACS37800Deadband::update(ACS37800 &sensor, ACS37800_DEADBAND_REPORT_t *report, bool *reported)
+{
+  *reported = false;
+
+  uint32_t registers[2];
+  ACS37800ERR error = sensor.readRegisters(registers, ACS37800_REGISTER_VOLATILE_20, 2); // Read registers 20 and 21
+
+  if (error != ACS37800_SUCCESS)
+    return (error); // Bail
+
+  unsigned long now = millis();
+  uint8_t changed = check(registers[0], registers[1], now);
+
+  if (changed == 0)
+    return (ACS37800_SUCCESS); // Nothing to report. No float math
+
+  ACS37800_CALIBRATION_t calibration;
+  sensor.getCalibration(&calibration);
+
+  report->changed = changed;
+  report->timestamp = now;
+  report->vRMS = (float)ACS37800_FIELD_VRMS::extract(registers[0]) * calibration.voltsPerCodeRMS;
+  report->iRMS = (float)ACS37800_FIELD_IRMS::extract(registers[0]) * calibration.ampsPerCodeRMS;
+  report->pActive = (float)ACS37800_FIELD_PACTIVE::extract(registers[1]) * calibration.wattsPerCode;
+  *reported = true;
+
+  return (ACS37800_SUCCESS);
+}
+
+//Compare the codes with the last reported codes. Returns the changed bits
+//Only the quantities which have changed become the new reference, so a slow drift is still reported eventually
+uint8_t ACS37800Deadband::check(uint32_t reg20Data, uint32_t reg21Data, unsigned long timestamp)
+{
+  int32_t codes[3];
+  codes[ACS37800_DEADBAND_VRMS] = ACS37800_FIELD_VRMS::extract(reg20Data);
+  codes[ACS37800_DEADBAND_IRMS] = ACS37800_FIELD_IRMS::extract(reg20Data);
+  codes[ACS37800_DEADBAND_PACTIVE] = ACS37800_FIELD_PACTIVE::extract(reg21Data);
+
+  uint8_t changed = 0;
+
+  if ((!_started) || ((_maxSilence > 0) && (timestamp - _lastReport >= _maxSilence)))
+  {
+    changed = 0x07 | (_started ? ACS37800_DEADBAND_HEARTBEAT : 0); // Report everything
+  }
+  else
+  {
+    for (uint8_t q = 0; q < 3; q++)
+    {
+      if (codes[q] == _reference[q])
+        continue; // Unchanged
+      int32_t difference = codes[q] - _reference[q];
+      if (difference < 0)
+        difference = 0 - difference;
+      int32_t reference = (_reference[q] < 0) ? 0 - _reference[q] : _reference[q];
+      int32_t band = ((uint32_t)_relative[q] * (uint32_t)reference) / 1000; // Both are 16-bit, so this can't overflow
+      if (band < _absolute[q])
+        band = _absolute[q];
+      if (difference > band)
+        changed |= 1 << q;
+    }
+  }
+
+  if (changed == 0)
+    return (0);
+
+  for (uint8_t q = 0; q < 3; q++)
+    if (changed & (1 << q))
+      _reference[q] = codes[q];
+  _lastReport = timestamp;
+  _started = true;
+
+  return (changed);
+}
+
+//Set the window length (ms). 0 = only rollover completes a window
+void ACS37800Statistics::setWindow(unsigned long windowMs)
+{
+  _windowMs = windowMs;
+}
+
+//Set the histogram range of the current window (codes)
+void ACS37800Statistics::setRange(ACS37800_STATISTICS_QUANTITY_e quantity, int32_t minCode, int32_t maxCode)
+{
+  if (quantity > ACS37800_STATISTICS_PACTIVE)
+    return;
+  clearAccumulator(&_current[quantity]); // Restart this quantity - the histogram and the sums must match
+  setAccumulatorRange(&_current[quantity], minCode, maxCode);
+  _ranged[quantity] = true;
+}
+
+//Read 0x20 and 0x21 and add them
+ACS37800ERR ACS37800Statistics::update(ACS37800 &sensor, bool *completed)
+{
+  *completed = false;
+
+  uint32_t registers[2];
+  ACS37800ERR error = sensor.readRegisters(registers, ACS37800_REGISTER_VOLATILE_20, 2); // Read registers 20 and 21
+
+  if (error != ACS37800_SUCCESS)
+    return (error); // Bail
+
+  *completed = add(registers[0], registers[1], millis());
+  return (ACS37800_SUCCESS);
+}
+
+//Add one sample of each quantity. Returns true if a window was completed first
+bool ACS37800Statistics::add(uint32_t reg20Data, uint32_t reg21Data, unsigned long timestamp)
+{
+  bool completed = false;
+
+  if (!_started)
+  {
+    for (uint8_t q = 0; q < 3; q++)
+    {
+      clearAccumulator(&_completed[q]); // No window has been completed yet
+      if (!_ranged[q])
+        clearAccumulator(&_current[q]);
+    }
+    if (!_ranged[ACS37800_STATISTICS_VRMS])
+      setAccumulatorRange(&_current[ACS37800_STATISTICS_VRMS], 0, 0xFFFF); // vrms is unsigned
+    if (!_ranged[ACS37800_STATISTICS_IRMS])
+      setAccumulatorRange(&_current[ACS37800_STATISTICS_IRMS], -0x8000, 0x7FFF); // irms and pactive are signed
+    if (!_ranged[ACS37800_STATISTICS_PACTIVE])
+      setAccumulatorRange(&_current[ACS37800_STATISTICS_PACTIVE], -0x8000, 0x7FFF);
+    _windowStart = timestamp;
+    _started = true;
+  }
+  else if ((_windowMs > 0) && (timestamp - _windowStart >= _windowMs))
+  {
+    unsigned long windows = (timestamp - _windowStart) / _windowMs; // Skip any empty windows
+    rollover(_windowStart + (windows * _windowMs));
+    completed = true;
+  }
+
+  accumulate(&_current[ACS37800_STATISTICS_VRMS], ACS37800_FIELD_VRMS::extract(reg20Data));
+  accumulate(&_current[ACS37800_STATISTICS_IRMS], ACS37800_FIELD_IRMS::extract(reg20Data));
+  accumulate(&_current[ACS37800_STATISTICS_PACTIVE], ACS37800_FIELD_PACTIVE::extract(reg21Data));
+
+  return (completed);
+}
+
+//Complete the current window. The next one starts at timestamp and uses this window's range (plus a margin) for its histograms
+void ACS37800Statistics::rollover(unsigned long timestamp)
+{
+  for (uint8_t q = 0; q < 3; q++)
+  {
+    _completed[q] = _current[q];
+    int32_t low = _current[q].low;
+    int32_t high = low + ((int32_t)ACS37800_STATISTICS_BINS << _current[q].binShift) - 1;
+    if (_current[q].count > 0)
+    {
+      int32_t margin = (_current[q].max - _current[q].min) / 8;
+      low = _current[q].min - margin;
+      high = _current[q].max + margin;
+    }
+    clearAccumulator(&_current[q]);
+    setAccumulatorRange(&_current[q], low, high);
+    _ranged[q] = false;
+  }
+  _completedStart = _windowStart;
+  _windowStart = timestamp;
+}
+
+//Return the statistics of the last completed window, or the current one
+void ACS37800Statistics::getStatistics(ACS37800_STATISTICS_QUANTITY_e quantity, ACS37800_STATISTICS_t *statistics, bool current)
+{
+  if (quantity > ACS37800_STATISTICS_PACTIVE)
+    return;
+
+  const ACS37800_ACCUMULATOR_t *accumulator = current ? &_current[quantity] : &_completed[quantity];
+  statistics->count = _started ? accumulator->count : 0;
+  statistics->start = current ? _windowStart : _completedStart;
+  statistics->min = accumulator->min;
+  statistics->max = accumulator->max;
+  statistics->mean = 0;
+  statistics->variance = 0;
+
+  if (statistics->count == 0)
+    return;
+
+  double mean = (double)accumulator->sum / accumulator->count; // Relative to offset
+  double variance = ((double)accumulator->sumSquares / accumulator->count) - (mean * mean);
+  statistics->mean = (float)(accumulator->offset + mean);
+  statistics->variance = (variance > 0) ? (float)variance : 0;
+}
+
+//Return the estimated percentile of the last completed window, or the current one
+int32_t ACS37800Statistics::getPercentile(ACS37800_STATISTICS_QUANTITY_e quantity, uint16_t perMille, bool current)
+{
+  if ((quantity > ACS37800_STATISTICS_PACTIVE) || (!_started))
+    return (0);
+  return (percentile(current ? &_current[quantity] : &_completed[quantity], perMille));
+}
+
+//Clear the sums, the extremes and the histogram
+void ACS37800Statistics::clearAccumulator(ACS37800_ACCUMULATOR_t *accumulator)
+{
+  accumulator->count = 0;
+  accumulator->min = 0;
+  accumulator->max = 0;
+  accumulator->offset = 0;
+  accumulator->sum = 0;
+  accumulator->sumSquares = 0;
+  for (uint8_t b = 0; b < ACS37800_STATISTICS_BINS; b++)
+    accumulator->bins[b] = 0;
+}
+
+//Set the histogram range. The bin width is a power of two, so each sample needs a shift - not a divide
+void ACS37800Statistics::setAccumulatorRange(ACS37800_ACCUMULATOR_t *accumulator, int32_t minCode, int32_t maxCode)
+{
+  if (maxCode < minCode)
+    maxCode = minCode;
+  uint32_t span = (uint32_t)(maxCode - minCode) + 1;
+  uint8_t shift = 0;
+  while (((uint32_t)ACS37800_STATISTICS_BINS << shift) < span)
+    shift++;
+  accumulator->low = minCode;
+  accumulator->binShift = shift;
+}
+
+//Add one code. Integer math only
+void ACS37800Statistics::accumulate(ACS37800_ACCUMULATOR_t *accumulator, int32_t code)
+{
+  if (accumulator->count == 0)
+  {
+    accumulator->offset = code;
+    accumulator->min = code;
+    accumulator->max = code;
+  }
+  else if (code < accumulator->min)
+    accumulator->min = code;
+  else if (code > accumulator->max)
+    accumulator->max = code;
+
+  int32_t delta = code - accumulator->offset;
+  accumulator->sum += delta;
+  accumulator->sumSquares += (uint64_t)((int64_t)delta * delta);
+  accumulator->count++;
+
+  int32_t bin = (code - accumulator->low) >> accumulator->binShift;
+  if (code < accumulator->low)
+    bin = 0; // Below the range
+  else if (bin >= ACS37800_STATISTICS_BINS)
+    bin = ACS37800_STATISTICS_BINS - 1; // Above the range
+  accumulator->bins[bin]++;
+}
+
+//Estimate a percentile from the histogram
+int32_t ACS37800Statistics::percentile(const ACS37800_ACCUMULATOR_t *accumulator, uint16_t perMille)
+{
+  if (accumulator->count == 0)
+    return (0);
+  if (perMille > 1000)
+    perMille = 1000;
+
+  uint64_t target = ((uint64_t)accumulator->count * perMille) / 1000; // The number of samples below the percentile
+  uint64_t below = 0;
+  uint8_t bin = 0;
+  while ((bin < ACS37800_STATISTICS_BINS - 1) && (below + accumulator->bins[bin] <= target))
+    below += accumulator->bins[bin++];
+
+  //Interpolate within the bin
+  int32_t result = accumulator->low + ((int32_t)bin << accumulator->binShift);
+  if (accumulator->bins[bin] > 0)
+    result += (int32_t)(((target - below) << accumulator->binShift) / accumulator->bins[bin]);
+
+  if (result < accumulator->min)
+    result = accumulator->min;
+  if (result > accumulator->max)
+    result = accumulator->max;
+  return (result);
+}
+
+//Set the nominal RMS voltage (codes of the source)
+void ACS37800PowerQuality::setNominal(uint16_t nominalCodes)
+{
+  _nominal = nominalCodes;
+  calculateThresholds();
+}
+
+//Set the thresholds (parts per thousand of the nominal)
+void ACS37800PowerQuality::setThresholds(uint16_t sagPerMille, uint16_t swellPerMille, uint16_t interruptionPerMille, uint16_t hysteresisPerMille)
+{
+  _sagPerMille = sagPerMille;
+  _swellPerMille = swellPerMille;
+  _interruptionPerMille = interruptionPerMille;
+  _hysteresisPerMille = hysteresisPerMille;
+  calculateThresholds();
+}
+
+//Convert the thresholds to codes, so each half cycle needs only compares
+void ACS37800PowerQuality::calculateThresholds()
+{
+  if (_nominal == 0)
+  {
+    _sagStart = 0; // Nothing is ever outside the thresholds
+    _sagEnd = 0;
+    _swellStart = 0xFFFFFFFF;
+    _swellEnd = 0xFFFFFFFF;
+    _interruption = 0;
+    return;
+  }
+
+  _sagStart = ((uint32_t)_nominal * _sagPerMille) / 1000;
+  _sagEnd = ((uint32_t)_nominal * (_sagPerMille + (uint32_t)_hysteresisPerMille)) / 1000;
+  _swellStart = ((uint32_t)_nominal * _swellPerMille) / 1000;
+  _swellEnd = (_swellPerMille > _hysteresisPerMille) ? ((uint32_t)_nominal * (_swellPerMille - _hysteresisPerMille)) / 1000 : 0;
+  _interruption = ((uint32_t)_nominal * _interruptionPerMille) / 1000;
+}
+
+//Read 0x20 and add it
+ACS37800ERR ACS37800PowerQuality::update(ACS37800 &sensor, bool *logged)
+{
+  *logged = false;
+
+  uint32_t data;
+  ACS37800ERR error = sensor.readRegister(&data, ACS37800_REGISTER_VOLATILE_20); // Read register 20
+
+  if (error != ACS37800_SUCCESS)
+    return (error); // Bail
+
+  *logged = addRMS(data, micros());
+  return (ACS37800_SUCCESS);
+}
+
+//Add one half-cycle vrms reading
+bool ACS37800PowerQuality::addRMS(uint32_t reg20Data, unsigned long timestamp)
+{
+  return (classify((uint16_t)ACS37800_FIELD_VRMS::extract(reg20Data), timestamp));
+}
+
+//Add one vcodes sample. A half cycle ends at a zero crossing - or after ACS37800_PQ_MAX_HALF_CYCLE if there is none
+bool ACS37800PowerQuality::addInstantaneous(uint32_t reg2AData, unsigned long timestamp)
+{
+  int32_t vCodes = ACS37800_FIELD_VCODES::extract(reg2AData);
+  bool positive = (vCodes >= 0);
+  bool logged = false;
+
+  if (!_halfCycleStarted)
+  {
+    if ((_halfCycleSamples > 0) && (positive != _positive)) // Wait for the first zero crossing
+    {
+      _halfCycleStarted = true;
+      _halfCycleStart = timestamp;
+      _halfCycleSamples = 0;
+      _halfCycleSquares = 0;
+    }
+    else
+      _halfCycleSamples = 1; // Remember that _positive is valid
+  }
+  else
+  {
+    unsigned long elapsed = timestamp - _halfCycleStart;
+    if (((positive != _positive) && (elapsed >= ACS37800_PQ_MIN_HALF_CYCLE)) || (elapsed >= ACS37800_PQ_MAX_HALF_CYCLE))
+    {
+      uint16_t rms = 0;
+      if (_halfCycleSamples > 0)
+        rms = (uint16_t)sqrt32((uint32_t)(_halfCycleSquares / _halfCycleSamples)); // Once per half cycle
+      logged = classify(rms, _halfCycleStart);
+      _halfCycleStart = timestamp;
+      _halfCycleSamples = 0;
+      _halfCycleSquares = 0;
+    }
+  }
+
+  _positive = positive;
+  if (_halfCycleStarted)
+  {
+    _halfCycleSquares += (uint32_t)(vCodes * vCodes);
+    _halfCycleSamples++;
+  }
+  return (logged);
+}
+
+//Add one vcodes sample from a waveform capture
+bool ACS37800PowerQuality::addSample(const ACS37800_WAVEFORM_SAMPLE_t &sample)
+{
+  return (addInstantaneous((uint32_t)(uint16_t)sample.vCodes, sample.timestamp));
+}
+
+//Process one half-cycle RMS. Returns true if an event was logged
+bool ACS37800PowerQuality::classify(uint16_t rms, unsigned long timestamp)
+{
+  _lastTimestamp = timestamp;
+
+  switch (_active.type)
+  {
+    case ACS37800_PQ_NONE:
+      startEvent(rms, timestamp);
+      return (false);
+
+    case ACS37800_PQ_SAG:
+    case ACS37800_PQ_INTERRUPTION:
+      if (rms < _active.extreme)
+        _active.extreme = rms;
+      if (rms < _interruption)
+        _active.type = ACS37800_PQ_INTERRUPTION;
+      if (rms < _sagEnd)
+        return (false); // Still in progress
+      break;
+
+    case ACS37800_PQ_SWELL:
+      if (rms > _active.extreme)
+        _active.extreme = rms;
+      if (rms > _swellEnd)
+        return (false); // Still in progress
+      break;
+  }
+
+  logEvent(timestamp);
+  startEvent(rms, timestamp); // e.g. straight from a sag into a swell
+  return (true);
+}
+
+//Start an event if rms is outside the thresholds
+void ACS37800PowerQuality::startEvent(uint16_t rms, unsigned long timestamp)
+{
+  if (rms < _interruption)
+    _active.type = ACS37800_PQ_INTERRUPTION;
+  else if (rms < _sagStart)
+    _active.type = ACS37800_PQ_SAG;
+  else if (rms > _swellStart)
+    _active.type = ACS37800_PQ_SWELL;
+  else
+  {
+    _active.type = ACS37800_PQ_NONE;
+    return;
+  }
+
+  _active.start = timestamp;
+  _active.duration = 0;
+  _active.extreme = rms;
+}
+
+//Log the active event. When the log is full, the oldest event is overwritten
+void ACS37800PowerQuality::logEvent(unsigned long end)
+{
+  _active.duration = end - _active.start;
+  _log[_head] = _active;
+  _head = (_head + 1) % ACS37800_PQ_MAX_EVENTS;
+  if (_count < ACS37800_PQ_MAX_EVENTS)
+    _count++;
+  else
+    _overruns++;
+  _active.type = ACS37800_PQ_NONE;
+}
+
+//Remove the oldest logged event
+bool ACS37800PowerQuality::pop(ACS37800_PQ_EVENT_t *event)
+{
+  if (_count == 0)
+    return (false);
+  *event = _log[(_head + ACS37800_PQ_MAX_EVENTS - _count) % ACS37800_PQ_MAX_EVENTS];
+  _count--;
+  return (true);
+}
+
+uint8_t ACS37800PowerQuality::available()
+{
+  return (_count);
+}
+
+uint32_t ACS37800PowerQuality::getOverruns()
+{
+  return (_overruns);
+}
+
+//Copy the event in progress
+bool ACS37800PowerQuality::getActive(ACS37800_PQ_EVENT_t *event)
+{
+  if (_active.type == ACS37800_PQ_NONE)
+    return (false);
+  *event = _active;
+  event->duration = _lastTimestamp - _active.start;
+  return (true);
+}
+
+//End any event without logging it, empty the log and wait for the next half cycle
+void ACS37800PowerQuality::reset()
+{
+  _active.type = ACS37800_PQ_NONE;
+  _halfCycleStarted = false;
+  _halfCycleSamples = 0;
+  _halfCycleSquares = 0;
+  _head = 0;
+  _count = 0;
+  _overruns = 0;
+}
+
+//Return the integer square root of value
+uint32_t ACS37800PowerQuality::sqrt32(uint32_t value)
+{
+  uint32_t root = 0;
+  uint32_t bit = (uint32_t)1 << 30;
+
+  while (bit > value)
+    bit >>= 2;
+
+  while (bit != 0)
+  {
+    if (value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+      root >>= 1;
+    bit >>= 2;
+  }
+
+  return (root);
+}
+
+//Add a device to the fleet. Returns the device index, or -1 if the fleet is full.
+int8_t ACS37800Fleet::addDevice(ACS37800 &device)
+{
+  if (_deviceCount >= ACS37800_FLEET_MAX_DEVICES)
+    return (-1);
+
+  _devices[_deviceCount] = &device;
+  _deviceCount++;
+  buildSchedule();
+  return (_deviceCount - 1);
+}
+
+//Return the number of devices in the fleet
+uint8_t ACS37800Fleet::getDeviceCount()
+{
+  return (_deviceCount);
+}
+
+//Return a pointer to device index. Returns NULL if index is invalid.
+ACS37800 *ACS37800Fleet::getDevice(uint8_t index)
+{
+  if (index >= _deviceCount)
+    return (NULL);
+  return (_devices[index]);
+}
+
+//Select the order in which the devices are read. The next read starts a new cycle.
+void ACS37800Fleet::setOrder(ACS37800_FLEET_ORDER_e order)
+{
+  _order = order;
+  buildSchedule();
+}
+
+//Read every device once, in schedule order. Returns the number of results.
+uint8_t ACS37800Fleet::pollCycle(ACS37800_FLEET_RESULT_t *results)
+{
+  _nextRead = 0; // Always start at the beginning of the schedule
+
+  for (uint8_t i = 0; i < _deviceCount; i++)
+    pollNext(&results[i]);
+
+  return (_deviceCount);
+}
+
+//Read the next device in the schedule. Returns true when this read completes a cycle.
+bool ACS37800Fleet::pollNext(ACS37800_FLEET_RESULT_t *result)
+{
+  if (_deviceCount == 0)
+    return (false);
+
+  uint8_t index = _schedule[_nextRead];
+  result->device = index;
+  result->error = _devices[index]->readMeasurements(&result->measurements);
+  result->timestamp = millis();
+
+  _nextRead++;
+  if (_nextRead < _deviceCount)
+    return (false);
+
+  _nextRead = 0;
+  return (true);
+}
+
+//Build the read schedule
+//ACS37800_FLEET_INTERLEAVE_BUSES takes one device from each bus in turn, so consecutive reads go to different buses
+//wherever possible. The buses are taken in the order they were first seen.
+void ACS37800Fleet::buildSchedule()
+{
+  _nextRead = 0;
+
+  if (_order == ACS37800_FLEET_ROUND_ROBIN)
+  {
+    for (uint8_t i = 0; i < _deviceCount; i++)
+      _schedule[i] = i;
+    return;
+  }
+
+  bool scheduled[ACS37800_FLEET_MAX_DEVICES];
+  for (uint8_t i = 0; i < _deviceCount; i++)
+    scheduled[i] = false;
+
+  uint8_t count = 0;
+  while (count < _deviceCount)
+  {
+    // Each pass takes the first unscheduled device on each bus
+    TwoWire *passBuses[ACS37800_FLEET_MAX_DEVICES];
+    uint8_t passBusCount = 0;
+
+    for (uint8_t i = 0; i < _deviceCount; i++)
+    {
+      if (scheduled[i])
+        continue;
+
+      TwoWire *bus = _devices[i]->getWirePort();
+      bool busUsed = false;
+      for (uint8_t b = 0; b < passBusCount; b++)
+      {
+        if (passBuses[b] == bus)
+          busUsed = true;
+      }
+
+      if (!busUsed)
+      {
+        passBuses[passBusCount++] = bus;
+        scheduled[i] = true;
+        _schedule[count++] = i;
+      }
+    }
+  }
 }
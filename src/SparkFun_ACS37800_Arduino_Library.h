@@ -19,6 +19,17 @@
 
 #include "Arduino.h"
 #include <Wire.h>
+#include "SparkFun_ACS37800_Record.h"
+
+//Debug printing
+//Set ACS37800_DEBUG_LEVEL to 0 to remove all of the debug printing at compile time: the debug strings and Stream calls
+//are not linked and enableDebugging does nothing. The error hook (setErrorHook) is still available.
+//The library is compiled separately from the sketch, so a #define in the sketch has no effect. Use a build flag
+//(e.g. -DACS37800_DEBUG_LEVEL=0) or change the default below.
+//Only 0 and non-zero are distinguished: there are no finer levels, and any non-zero value compiles all of the debug printing.
+#ifndef ACS37800_DEBUG_LEVEL
+#define ACS37800_DEBUG_LEVEL 1
+#endif
 
 // The default I2C Address is 0x60 when DIO_0 and DIO_1 are 0V on start-up
 // (There is a typo in the datasheet that suggests it is 0x61. It isn't...!)
@@ -43,9 +54,34 @@ const float ACS37800_DEFAULT_CURRENT_RANGE = 30;
 typedef enum {
   ACS37800_SUCCESS = 0,
   ACS37800_ERR_I2C_ERROR,
-  ACS37800_ERR_REGISTER_READ_MODIFY_WRITE_FAILURE
+  ACS37800_ERR_REGISTER_READ_MODIFY_WRITE_FAILURE,
+  ACS37800_ERR_ASYNC_BUSY,
+  ACS37800_ERR_SETTLE_TIMEOUT,
+  ACS37800_ERR_INVALID_REGISTER,
+  ACS37800_ERR_ZERO_CROSSING_TIMEOUT,
+  ACS37800_ERR_BUFFER_FULL,
+  ACS37800_ERR_INTERRUPT_UNAVAILABLE
 } ACS37800ERR;
 
+//Time allowed for the shadow/eeprom memory to be updated after a write (ms)
+const unsigned long ACS37800_SETTLE_TIME_MS = 100;
+
+//The ADC sample rate (Hz). The RMS and power registers (0x20 - 0x22) update every numptsout (0x25) samples
+const unsigned long ACS37800_SAMPLE_RATE = 32000;
+
+//pollMeasurements re-reads numptsout after this many updates, in case N has changed (zero crossing mode)
+const uint8_t ACS37800_NUMPTSOUT_REFRESH = 64;
+
+//How to wait for the shadow/eeprom memory to be updated after a write
+typedef enum
+{
+  ACS37800_SETTLE_FIXED_DELAY = 0, // Wait for ACS37800_SETTLE_TIME_MS. The default.
+  ACS37800_SETTLE_POLL_READBACK // Read the register back until the written value (and a valid ECC) appears. Usually much faster.
+} ACS37800_SETTLE_POLICY_e;
+
+//The data bits of the EEPROM and shadow registers. Bits 26-31 are the ECC.
+const uint32_t ACS37800_REGISTER_DATA_MASK = 0x03FFFFFF;
+
 //EEPROM Registers
 const uint8_t ACS37800_REGISTER_EEPROM_0B = 0x0B;
 const uint8_t ACS37800_REGISTER_EEPROM_0C = 0x0C;
@@ -322,6 +358,93 @@ typedef struct
   } data;
 } ACS37800_REGISTER_2D_t;
 
+//Register field descriptors
+//Each descriptor describes one field: its register address, bit offset, width and signedness.
+//extract and insert compile down to shifts and masks. Use them with getField / setField / stageField.
+//The configuration fields use the shadow address (0x1B - 0x1F). The EEPROM address is 0x10 below.
+
+template <uint8_t ADDRESS, uint8_t OFFSET, uint8_t WIDTH, bool SIGNED = false>
+struct ACS37800Field
+{
+  static const uint8_t address = ADDRESS;
+  static const uint8_t offset = OFFSET;
+  static const uint8_t width = WIDTH;
+  static const bool isSigned = SIGNED;
+  static const uint32_t mask = ((WIDTH >= 32) ? 0xFFFFFFFFUL : ((1UL << (WIDTH & 31)) - 1)) << OFFSET;
+  static const bool isConfig = (ADDRESS >= 0x1B) && (ADDRESS <= 0x1F); // Shadow registers - with EEPROM 0x10 below
+
+  //Extract the field from the register contents. Signed fields are sign-extended.
+  static int32_t extract(uint32_t reg)
+  {
+    uint32_t field = (reg & mask) >> OFFSET;
+    if (SIGNED && (WIDTH < 32) && (field & (1UL << ((WIDTH - 1) & 31))))
+      field |= ~(mask >> OFFSET); // Sign-extend
+    return ((int32_t)field);
+  }
+
+  //Return reg with the field replaced by value. value is truncated to the width of the field.
+  static uint32_t insert(uint32_t reg, int32_t value)
+  {
+    return ((reg & ~mask) | (((uint32_t)value << OFFSET) & mask));
+  }
+};
+
+//Shadow / EEPROM 0x1B / 0x0B
+typedef ACS37800Field<0x1B, 0, 9, true> ACS37800_FIELD_QVO_FINE;
+typedef ACS37800Field<0x1B, 9, 10, true> ACS37800_FIELD_SNS_FINE;
+typedef ACS37800Field<0x1B, 19, 3> ACS37800_FIELD_CRS_SNS;
+typedef ACS37800Field<0x1B, 22, 1> ACS37800_FIELD_IAVGSELEN;
+typedef ACS37800Field<0x1B, 23, 1> ACS37800_FIELD_PAVGSELEN;
+//Shadow / EEPROM 0x1C / 0x0C
+typedef ACS37800Field<0x1C, 0, 7> ACS37800_FIELD_RMS_AVG_1;
+typedef ACS37800Field<0x1C, 7, 10> ACS37800_FIELD_RMS_AVG_2;
+typedef ACS37800Field<0x1C, 17, 8, true> ACS37800_FIELD_VCHAN_OFFSET_CODE;
+//Shadow / EEPROM 0x1D / 0x0D
+typedef ACS37800Field<0x1D, 7, 1> ACS37800_FIELD_ICHAN_DEL_EN;
+typedef ACS37800Field<0x1D, 9, 3> ACS37800_FIELD_CHAN_DEL_SEL;
+typedef ACS37800Field<0x1D, 13, 8> ACS37800_FIELD_FAULT;
+typedef ACS37800Field<0x1D, 21, 3> ACS37800_FIELD_FLTDLY;
+//Shadow / EEPROM 0x1E / 0x0E
+typedef ACS37800Field<0x1E, 0, 6> ACS37800_FIELD_VEVENT_CYCS;
+typedef ACS37800Field<0x1E, 8, 6> ACS37800_FIELD_OVERVREG;
+typedef ACS37800Field<0x1E, 14, 6> ACS37800_FIELD_UNDERVREG;
+typedef ACS37800Field<0x1E, 20, 1> ACS37800_FIELD_DELAYCNT_SEL;
+typedef ACS37800Field<0x1E, 21, 1> ACS37800_FIELD_HALFCYCLE_EN;
+typedef ACS37800Field<0x1E, 22, 1> ACS37800_FIELD_SQUAREWAVE_EN;
+typedef ACS37800Field<0x1E, 23, 1> ACS37800_FIELD_ZEROCROSSCHANSEL;
+typedef ACS37800Field<0x1E, 24, 1> ACS37800_FIELD_ZEROCROSSEDGESEL;
+//Shadow / EEPROM 0x1F / 0x0F
+typedef ACS37800Field<0x1F, 2, 7> ACS37800_FIELD_I2C_SLV_ADDR;
+typedef ACS37800Field<0x1F, 9, 1> ACS37800_FIELD_I2C_DIS_SLV_ADDR;
+typedef ACS37800Field<0x1F, 10, 2> ACS37800_FIELD_DIO_0_SEL;
+typedef ACS37800Field<0x1F, 12, 2> ACS37800_FIELD_DIO_1_SEL;
+typedef ACS37800Field<0x1F, 14, 10> ACS37800_FIELD_N;
+typedef ACS37800Field<0x1F, 24, 1> ACS37800_FIELD_BYPASS_N_EN;
+//Volatile registers
+typedef ACS37800Field<0x20, 0, 16> ACS37800_FIELD_VRMS;
+typedef ACS37800Field<0x20, 16, 16, true> ACS37800_FIELD_IRMS;
+typedef ACS37800Field<0x21, 0, 16, true> ACS37800_FIELD_PACTIVE;
+typedef ACS37800Field<0x21, 16, 16> ACS37800_FIELD_PIMAG;
+typedef ACS37800Field<0x22, 0, 16> ACS37800_FIELD_PAPPARENT;
+typedef ACS37800Field<0x22, 16, 11, true> ACS37800_FIELD_PFACTOR;
+typedef ACS37800Field<0x22, 27, 1> ACS37800_FIELD_POSANGLE;
+typedef ACS37800Field<0x22, 28, 1> ACS37800_FIELD_POSPF;
+typedef ACS37800Field<0x25, 0, 10> ACS37800_FIELD_NUMPTSOUT;
+typedef ACS37800Field<0x26, 0, 16> ACS37800_FIELD_VRMSAVGONESEC;
+typedef ACS37800Field<0x26, 16, 16, true> ACS37800_FIELD_IRMSAVGONESEC;
+typedef ACS37800Field<0x27, 0, 16> ACS37800_FIELD_VRMSAVGONEMIN;
+typedef ACS37800Field<0x27, 16, 16, true> ACS37800_FIELD_IRMSAVGONEMIN;
+typedef ACS37800Field<0x28, 0, 16, true> ACS37800_FIELD_PACTAVGONESEC;
+typedef ACS37800Field<0x29, 0, 16, true> ACS37800_FIELD_PACTAVGONEMIN;
+typedef ACS37800Field<0x2A, 0, 16, true> ACS37800_FIELD_VCODES;
+typedef ACS37800Field<0x2A, 16, 16, true> ACS37800_FIELD_ICODES;
+typedef ACS37800Field<0x2C, 0, 16, true> ACS37800_FIELD_PINSTANT;
+typedef ACS37800Field<0x2D, 0, 1> ACS37800_FIELD_VZEROCROSSOUT;
+typedef ACS37800Field<0x2D, 1, 1> ACS37800_FIELD_FAULTOUT;
+typedef ACS37800Field<0x2D, 2, 1> ACS37800_FIELD_FAULTLATCHED;
+typedef ACS37800Field<0x2D, 3, 1> ACS37800_FIELD_OVERVOLTAGE;
+typedef ACS37800Field<0x2D, 4, 1> ACS37800_FIELD_UNDERVOLTAGE;
+
 //Register Field Enums
 
 typedef enum
@@ -365,6 +488,18 @@ typedef enum
   ACS37800_DIO1_FUNC_OV_OR_UV_OR_OCF_LAT
 } ACS37800_DIO1_FUNC_e; //DIO_1 Function
 
+typedef enum
+{
+  ACS37800_ZC_CHANNEL_VOLTAGE = 0,
+  ACS37800_ZC_CHANNEL_CURRENT
+} ACS37800_ZC_CHANNEL_e; //Zero crossing channel (zerocrosschansel)
+
+typedef enum
+{
+  ACS37800_ZC_EDGE_RISING = 0,
+  ACS37800_ZC_EDGE_RISING_AND_FALLING
+} ACS37800_ZC_EDGE_e; //Zero crossing edge (zerocrossedgesel)
+
 typedef enum
 {
   ACS37800_EEPROM_ECC_NO_ERROR = 0,
@@ -373,6 +508,226 @@ typedef enum
   ACS37800_EEPROM_ECC_NO_MEANING
 } ACS37800_EEPROM_ECC_e; //EEPROM ECC Errors
 
+//Conversion factors : the code-to-units scaling for each measurement
+//These are precomputed from the sense / divider resistances and the current sensing range,
+//so each conversion in the read functions is a single multiply
+
+//Integer scaling for FPU-less processors: result = ((code * multiplier) + rounding) >> shift
+typedef struct
+{
+  int32_t multiplier;
+  uint8_t shift;
+} ACS37800_FIXED_SCALE_t;
+
+typedef struct
+{
+  float voltsPerCodeRMS; // vrms (0x20) : Volts per LSB
+  float ampsPerCodeRMS; // irms (0x20) : Amps per LSB
+  float voltsPerCodeInst; // vcodes (0x2A) : Volts per LSB
+  float ampsPerCodeInst; // icodes (0x2A) : Amps per LSB
+  float wattsPerCode; // pactive (0x21) and pinstant (0x2C) : Watts per LSB
+  float varPerCode; // pimag (0x21) : VAR per LSB
+  float vaPerCode; // papparent (0x22) : VA per LSB
+  ACS37800_FIXED_SCALE_t milliVoltsRMS; // vrms (0x20) to mV
+  ACS37800_FIXED_SCALE_t milliAmpsRMS; // irms (0x20) to mA
+  ACS37800_FIXED_SCALE_t milliVoltsInst; // vcodes (0x2A) to mV
+  ACS37800_FIXED_SCALE_t milliAmpsInst; // icodes (0x2A) to mA
+  ACS37800_FIXED_SCALE_t milliWatts; // pactive (0x21) and pinstant (0x2C) to mW
+  ACS37800_FIXED_SCALE_t milliVAR; // pimag (0x21) to mVAR
+  ACS37800_FIXED_SCALE_t milliVA; // papparent (0x22) to mVA
+} ACS37800_CALIBRATION_t;
+
+//Decoded contents of the RMS and power registers (0x20 - 0x22)
+
+typedef struct
+{
+  float vRMS; // Volts
+  float iRMS; // Amps
+  float pActive; // Watts
+  float pReactive; // VAR
+  float pApparent; // VA
+  float pFactor; // +/- 1.0
+  bool posangle; // Lagging (true) or leading (false)
+  bool pospf; // Consumed (true) or generated (false)
+} ACS37800_MEASUREMENTS_t;
+
+//Raw (undecoded) contents of the measurement registers
+//readRaw fills this without doing any float math. Use ACS37800::decode to convert it later - or off-line.
+
+typedef struct
+{
+  uint32_t reg20; // vrms, irms
+  uint32_t reg21; // pactive, pimag
+  uint32_t reg22; // papparent, pfactor, posangle, pospf
+  uint32_t reg2A; // vcodes, icodes
+  uint32_t reg2C; // pinstant
+} ACS37800_RAW_SNAPSHOT_t;
+
+//The on-chip averages : registers 0x26 and 0x28 (one second) or 0x27 and 0x29 (one minute)
+
+typedef struct
+{
+  float vRMS; // Volts
+  float iRMS; // Amps
+  float pActive; // Watts
+  unsigned long timestamp; // millis() when the registers were read
+} ACS37800_AVERAGES_t;
+
+//Decoded contents of ACS37800_RAW_SNAPSHOT_t
+
+typedef struct
+{
+  ACS37800_MEASUREMENTS_t measurements; // From 0x20 - 0x22
+  float vInst; // Volts
+  float iInst; // Amps
+  float pInst; // Watts
+} ACS37800_DECODED_SNAPSHOT_t;
+
+//Configuration transaction : changes to the shadow (0x1B - 0x1F) and EEPROM (0x0B - 0x0F) registers
+//Changes are staged with stageConfig (etc.) and then written together by commitConfig,
+//using a single customer access code unlock, one read-modify-write per register and a single settle
+
+typedef struct
+{
+  uint32_t value[5]; // The staged field values for registers 0x1B / 0x0B - 0x1F / 0x0F. Shared by shadow and EEPROM
+  uint32_t shadowMask[5]; // The bits to be changed in shadow registers 0x1B - 0x1F
+  uint32_t eepromMask[5]; // The bits to be changed in EEPROM registers 0x0B - 0x0F
+} ACS37800_CONFIG_t;
+
+//Asynchronous (non-blocking) register access
+
+typedef enum
+{
+  ACS37800_ASYNC_IDLE = 0, // Nothing in progress
+  ACS37800_ASYNC_BUSY, // An operation is in progress - keep calling checkAsync
+  ACS37800_ASYNC_COMPLETE // The operation has just finished. The result is available from getAsyncResult
+} ACS37800_ASYNC_STATUS_e;
+
+//Event handling : the DIO_0 / DIO_1 pins trigger an MCU interrupt and register 0x2D is only read when one fires
+
+const uint8_t ACS37800_MAX_EVENT_DEVICES = 4; // The maximum number of ACS37800 objects which can use interrupts at the same time
+
+//The interrupt mode passed to attachInterrupt: RISING, FALLING or CHANGE.
+//ArduinoCore-API cores (e.g. Arduino mbed, Renesas) use the PinStatus enum. The others use an int.
+#if defined(ARDUINO_API_VERSION)
+typedef PinStatus ACS37800_INTERRUPT_MODE_t;
+#else
+typedef int ACS37800_INTERRUPT_MODE_t;
+#endif
+
+//Callback for events. flags contains register 0x2D.
+typedef void (*ACS37800_EVENT_CALLBACK)(ACS37800_REGISTER_2D_t flags, void *context);
+
+//Callback for asynchronous operations. data contains the register contents for startReadRegister.
+typedef void (*ACS37800_ASYNC_CALLBACK)(ACS37800ERR result, uint32_t data, void *context);
+
+//Error hook. Called whenever a register access fails, or a shadow / EEPROM write does not settle.
+//address is the register. detail is the endTransmission result or the number of bytes returned by requestFrom (I2C errors),
+//or zero. A lightweight alternative to the debug printing: no strings are needed.
+typedef void (*ACS37800_ERROR_HOOK)(ACS37800ERR error, uint8_t address, uint8_t detail, void *context);
+
+//Waveform capture : raw instantaneous samples from 0x2A (and optionally 0x2C)
+
+typedef struct
+{
+  unsigned long timestamp; // micros() when the sample was read
+  int16_t vCodes; // vcodes (0x2A). Convert using voltsPerCodeInst
+  int16_t iCodes; // icodes (0x2A). Convert using ampsPerCodeInst
+  int16_t pCodes; // pinstant (0x2C). Convert using wattsPerCode. Zero if power was not captured
+} ACS37800_WAVEFORM_SAMPLE_t;
+
+//Harmonic analysis of captured waveforms
+
+const uint8_t ACS37800_MAX_HARMONICS = 15; // The fundamental plus harmonics 2 - 15
+
+typedef enum
+{
+  ACS37800_WAVEFORM_VOLTAGE = 0, // vCodes
+  ACS37800_WAVEFORM_CURRENT, // iCodes
+  ACS37800_WAVEFORM_POWER // pCodes
+} ACS37800_WAVEFORM_CHANNEL_e;
+
+typedef struct
+{
+  uint8_t harmonics; // The number of harmonics analyzed. Harmonics above the Nyquist frequency are skipped
+  uint32_t magnitude[ACS37800_MAX_HARMONICS]; // Peak amplitude (codes) of the fundamental [0] and each harmonic [1 - 14]
+  uint32_t thd; // Total harmonic distortion in units of 0.01%: 10000 = 100%
+} ACS37800_HARMONICS_t;
+
+//How captureCycles detects the voltage zero crossings
+typedef enum
+{
+  ACS37800_ZC_SOURCE_SOFTWARE = 0, // A negative-to-positive change in vcodes, with hysteresis. No extra bus traffic
+  ACS37800_ZC_SOURCE_POLL_2D, // A rising edge on vzerocrossout (0x2D). Needs the square wave output (see setZeroCrossing)
+  ACS37800_ZC_SOURCE_INTERRUPT // A DIO_0 interrupt. The user's interrupt routine calls notifyZeroCrossing
+} ACS37800_ZC_SOURCE_e;
+
+//ACS37800_ZC_SOURCE_SOFTWARE : noise near zero must not be counted as extra cycles
+const int16_t ACS37800_ZC_HYSTERESIS = 256; // vcodes : a rising crossing only counts after vcodes has been below -ACS37800_ZC_HYSTERESIS
+const unsigned long ACS37800_ZC_MIN_PERIOD = 8000; // Rising crossings closer than this (us) are noise. 125Hz
+
+//A ring buffer of waveform samples, using storage provided by the caller
+//When the buffer is full, the oldest sample is overwritten and the overrun count is incremented
+class ACS37800WaveformBuffer
+{
+  public:
+
+    ACS37800WaveformBuffer(ACS37800_WAVEFORM_SAMPLE_t *storage, uint16_t size);
+
+    void push(const ACS37800_WAVEFORM_SAMPLE_t &sample); // Add a sample
+    bool pop(ACS37800_WAVEFORM_SAMPLE_t *sample); // Remove the oldest sample. Returns false if the buffer is empty
+    bool peek(uint16_t index, ACS37800_WAVEFORM_SAMPLE_t *sample); // Copy sample index (0 is the oldest) without removing it
+    uint16_t available(); // The number of samples in the buffer
+    uint16_t getSize(); // The capacity of the buffer
+    uint32_t getOverruns(); // The number of samples overwritten before they were popped
+    void clear(); // Empty the buffer and reset the overrun count
+
+  private:
+
+    ACS37800_WAVEFORM_SAMPLE_t *_storage;
+    uint16_t _size;
+    uint16_t _head = 0; // Where the next sample will be written
+    uint16_t _count = 0;
+    uint32_t _overruns = 0;
+};
+
+//Harmonic analysis using a fixed-point Goertzel filter for each harmonic
+//The samples must contain a whole number of cycles (see captureCycles) and be evenly spaced
+//Memory use is fixed: two 64-bit states per harmonic, on the stack. The cost is (samples x harmonics) multiplies.
+//The filter coefficients are calculated in integer too, so the results do not depend on the size of double (32 bits on AVR).
+class ACS37800HarmonicAnalyzer
+{
+  public:
+
+    //Analyze channel of the samples in buffer, which contains cycles whole cycles. The buffer is not changed.
+    //Returns false if there are too few samples or the fundamental is zero (thd is then zero).
+    static bool analyze(ACS37800WaveformBuffer &buffer, uint8_t cycles, ACS37800_WAVEFORM_CHANNEL_e channel,
+                        ACS37800_HARMONICS_t *result, uint8_t harmonics = ACS37800_MAX_HARMONICS);
+
+    //Analyze an array of count samples containing cycles whole cycles
+    static bool analyze(const int16_t *samples, uint16_t count, uint8_t cycles,
+                        ACS37800_HARMONICS_t *result, uint8_t harmonics = ACS37800_MAX_HARMONICS);
+
+  private:
+
+    //The Goertzel filters
+    typedef struct
+    {
+      uint8_t harmonics;
+      int32_t cosQ30[ACS37800_MAX_HARMONICS]; // cos(w) in Q30 format
+      int32_t sinQ30[ACS37800_MAX_HARMONICS]; // sin(w) in Q30 format
+      int64_t s1[ACS37800_MAX_HARMONICS];
+      int64_t s2[ACS37800_MAX_HARMONICS];
+    } GOERTZEL_t;
+
+    static bool begin(GOERTZEL_t *filters, uint16_t count, uint8_t cycles, uint8_t harmonics);
+    static void update(GOERTZEL_t *filters, int16_t sample);
+    static bool finish(GOERTZEL_t *filters, uint16_t count, ACS37800_HARMONICS_t *result);
+    static void sinCosQ30(uint32_t bin, uint16_t count, int32_t *cosQ30, int32_t *sinQ30); // The coefficients for DFT bin bin, without floating point
+    static int64_t mulQ30(int32_t a, int64_t b); // (a * b) >> 30 without overflow
+    static uint64_t sqrt64(uint64_t value); // Integer square root
+};
+
 class ACS37800
 {
   // User-accessible "public" interface
@@ -389,10 +744,19 @@ class ACS37800
 
     //Debugging
     void enableDebugging(Stream &debugPort = Serial); //Turn on debug printing. If user doesn't specify then Serial will be used.
+    void setErrorHook(ACS37800_ERROR_HOOK hook, void *context = NULL); //Call hook on each register access error. Use NULL to disable.
+
+    //Return the I2C port and address passed to begin
+    TwoWire *getWirePort();
+    uint8_t getI2Caddress();
 
     //Basic methods for accessing registers
     ACS37800ERR readRegister(uint32_t *data, uint8_t address);
     ACS37800ERR writeRegister(uint32_t data, uint8_t address);
+    //Read count consecutive registers into data[0..count-1]
+    //The ACS37800 does not auto-increment the register address, so each register still needs its own
+    //register-address write and read. But the reads are issued back-to-back with no decoding in between.
+    ACS37800ERR readRegisters(uint32_t *data, uint8_t address, uint8_t count);
 
     //Change the I2C address in EEPROM (i2c_slv_addr)
     //This also sets the i2c_dis_slv_addr flag so the DIO pins will no longer define the I2C address
@@ -406,21 +770,163 @@ class ACS37800
     //Set/Clear the Bypass_N_Enable flag
     ACS37800ERR setBypassNenable(bool bypass, bool _eeprom = false);
     ACS37800ERR getBypassNenable(bool *bypass); // Read and return the bypass_n_en flag (from _shadow_ memory)
+    //Set the zero crossing channel and edge (zerocrosschansel and zerocrossedgesel)
+    //squareWave sets squarewave_en: the zero crossing output is a square wave instead of a pulse
+    ACS37800ERR setZeroCrossing(ACS37800_ZC_CHANNEL_e channel, ACS37800_ZC_EDGE_e edge, bool squareWave, bool _eeprom = false);
+    //Set the iavgselen and pavgselen flags, which select what the one second and one minute averages (0x26 - 0x29) are calculated from
+    ACS37800ERR setAverageSelect(bool iavgselen, bool pavgselen, bool _eeprom = false);
+    //Set the number of values in the averages: rms_avg_1 (one second, 0 - 127) and rms_avg_2 (one minute, 0 - 1023)
+    ACS37800ERR setAverageCounts(uint8_t rmsAvg1, uint16_t rmsAvg2, bool _eeprom = false);
+    //Set the functions of the DIO_0 and DIO_1 pins (dio_0_sel and dio_1_sel)
+    ACS37800ERR setDIOFunctions(ACS37800_DIO0_FUNC_e dio0, ACS37800_DIO1_FUNC_e dio1, bool _eeprom = false);
+    //Set the overvoltage and undervoltage thresholds (overvreg and undervreg, 0 - 63)
+    //and the number of cycles the voltage must be out of range before the event is flagged (vevent_cycs, 0 - 63)
+    ACS37800ERR setVoltageEvents(uint8_t overvreg, uint8_t undervreg, uint8_t veventCycles, bool _eeprom = false);
+    //Set the overcurrent fault threshold (fault, 0 - 255) and delay (fltdly)
+    ACS37800ERR setOvercurrentFault(uint8_t fault, ACS37800_FLTDLY_e delay, bool _eeprom = false);
     // Read and return the gain (from _shadow_ memory)
     ACS37800ERR getCurrentCoarseGain(float *currentCoarseGain);
 
+    //Configuration transactions - to change several settings with a single unlock and a single settle
+    //Call beginConfig, stage the changes, then call commitConfig
+    static void beginConfig(ACS37800_CONFIG_t *config); // Clear all staged changes
+    static ACS37800ERR stageConfig(ACS37800_CONFIG_t *config, uint8_t address, uint32_t mask, uint32_t value); // Stage a change to the masked bits of one shadow or EEPROM register
+    static void stageNumberOfSamples(ACS37800_CONFIG_t *config, uint32_t numberOfSamples, bool _eeprom = false);
+    static void stageBypassNenable(ACS37800_CONFIG_t *config, bool bypass, bool _eeprom = false);
+    static void stageZeroCrossing(ACS37800_CONFIG_t *config, ACS37800_ZC_CHANNEL_e channel, ACS37800_ZC_EDGE_e edge, bool squareWave, bool _eeprom = false);
+    static void stageAverageSelect(ACS37800_CONFIG_t *config, bool iavgselen, bool pavgselen, bool _eeprom = false);
+    static void stageAverageCounts(ACS37800_CONFIG_t *config, uint8_t rmsAvg1, uint16_t rmsAvg2, bool _eeprom = false);
+    static void stageDIOFunctions(ACS37800_CONFIG_t *config, ACS37800_DIO0_FUNC_e dio0, ACS37800_DIO1_FUNC_e dio1, bool _eeprom = false);
+    static void stageVoltageEvents(ACS37800_CONFIG_t *config, uint8_t overvreg, uint8_t undervreg, uint8_t veventCycles, bool _eeprom = false);
+    static void stageOvercurrentFault(ACS37800_CONFIG_t *config, uint8_t fault, ACS37800_FLTDLY_e delay, bool _eeprom = false);
+    ACS37800ERR commitConfig(const ACS37800_CONFIG_t *config); // Write all of the staged changes
+
+    //Optional cache of the shadow (0x1B - 0x1F) and EEPROM (0x0B - 0x0F) registers
+    //When enabled, the getters and commitConfig are served from RAM and the setters only touch the bus for the write
+    void enableRegisterCache(bool enable = true); // The cache starts empty
+    void invalidateRegisterCache(); // Call this if the device is reset or reconfigured externally
+    ACS37800ERR refreshRegisterCache(bool dirtyOnly = false); // Re-read the registers. dirtyOnly: only those written but not yet read back
+
+    //Select how the setters wait for the shadow/eeprom memory to be updated after a write
+    //With ACS37800_SETTLE_POLL_READBACK the setters return ACS37800_ERR_SETTLE_TIMEOUT if the value has not appeared after timeoutMs
+    //A register reads zero while it is being written, so a register written with all zero data bits always waits ACS37800_SETTLE_TIME_MS
+    void setSettlePolicy(ACS37800_SETTLE_POLICY_e policy, unsigned long timeoutMs = ACS37800_SETTLE_TIME_MS);
+
     //Basic methods for accessing the volatile registers
     ACS37800ERR readRMS(float *vRMS, float *iRMS); // Read volatile register 0x20. Return the vRMS and iRMS.
     ACS37800ERR readPowerActiveReactive(float *pActive, float *pReactive); // Read volatile register 0x21. Return the pactive and pimag (reactive)
     ACS37800ERR readPowerFactor(float *pApparent, float *pFactor, bool *posangle, bool *pospf); // Read volatile register 0x22. Return the apparent power, power factor, leading / lagging, generated / consumed
     ACS37800ERR readInstantaneous(float *vInst, float *iInst, float *pInst); // Read volatile registers 0x2A and 0x2C. Return the vInst, iInst and pInst.
     ACS37800ERR readErrorFlags(ACS37800_REGISTER_2D_t *errorFlags); // Read volatile register 0x2D. Return its contents in errorFlags.
+    ACS37800ERR readRMSAverage(float *vRMS, float *iRMS, bool oneMinute = false); // Read volatile register 0x26 (or 0x27). Return the averaged vRMS and iRMS
+    ACS37800ERR readPowerAverage(float *pActive, bool oneMinute = false); // Read volatile register 0x28 (or 0x29). Return the averaged pactive
+
+    //Read the one second (or one minute) averages - but only if a second (or minute) has passed since they were last read
+    //updated is set to true if the registers were read. Otherwise averages is not changed and the bus is not used
+    ACS37800ERR pollAverages(ACS37800_AVERAGES_t *averages, bool *updated, bool oneMinute = false);
+    ACS37800ERR readMeasurements(ACS37800_MEASUREMENTS_t *measurements); // Read volatile registers 0x20 - 0x22 together. Decode everything once all three have been read.
+
+    //Read 0x20 - 0x22 just after the chip updates them. Call this as often as you like (e.g. once per pass of loop).
+    //The update period is numptsout (0x25) samples at 32kHz. The bus is not used until the next update is due.
+    //If the registers have not changed when they are read, the read was too early: it is retried once sooner, and the schedule moves later.
+    //If the retry does not see a change either, the readings are steady and the registers are read once per period.
+    //fresh is set to true when measurements holds new values. Otherwise measurements is not changed.
+    //Readings which are genuinely unchanged for two periods are reported as fresh.
+    ACS37800ERR pollMeasurements(ACS37800_MEASUREMENTS_t *measurements, bool *fresh);
+    unsigned long getUpdatePeriod(); // The update period used by pollMeasurements (microseconds). Zero until the first poll
+    void resetPollMeasurements(); // Re-read numptsout and restart the schedule on the next poll
+    ACS37800ERR readRaw(ACS37800_RAW_SNAPSHOT_t *snapshot); // Read volatile registers 0x20 - 0x22, 0x2A and 0x2C. No decoding.
+
+    //Binary logging - see SparkFun_ACS37800_Record.h for the record format
+    //readRecord reads the registers selected by contents (ACS37800_RECORD_CONTENT_e bits). The timestamp is micros().
+    //writeRecord reads them, encodes them with encoder and writes the record to stream. Use one encoder per stream.
+    ACS37800ERR readRecord(ACS37800_RECORD_t *record, uint8_t deviceId, uint8_t contents);
+    ACS37800ERR writeRecord(Stream &stream, ACS37800RecordEncoder &encoder, uint8_t deviceId,
+                            uint8_t contents = ACS37800_RECORD_RMS | ACS37800_RECORD_POWER | ACS37800_RECORD_POWER_FACTOR);
+
+    //Capture count instantaneous samples into buffer, as fast as the bus allows. No decoding.
+    //Each sample reads 0x2A (vcodes and icodes are read together, so they are aligned). If includePower is true, 0x2C is read too.
+    //Call with a small count from loop to stream continuously.
+    ACS37800ERR captureInstantaneous(ACS37800WaveformBuffer &buffer, uint16_t count, bool includePower = false);
+
+    //Capture whole voltage cycles: sampling starts at a rising zero crossing and stops at the zero crossing cycles later
+    //buffer is cleared first. It must be large enough for all of the cycles, otherwise ACS37800_ERR_BUFFER_FULL is returned.
+    //ACS37800_ERR_ZERO_CROSSING_TIMEOUT is returned if there is no zero crossing for timeoutMs.
+    ACS37800ERR captureCycles(ACS37800WaveformBuffer &buffer, uint8_t cycles, ACS37800_ZC_SOURCE_e source = ACS37800_ZC_SOURCE_SOFTWARE,
+                              bool includePower = false, unsigned long timeoutMs = 100);
+    void notifyZeroCrossing(); // For ACS37800_ZC_SOURCE_INTERRUPT : call this from the DIO_0 interrupt routine
+
+    //Event handling
+    //attachEventInterrupts arms an interrupt on the MCU pins connected to DIO_0 and DIO_1 (use -1 for a pin which is not connected)
+    //checkEvents only reads 0x2D if one of the pins has fired since the last call. It then calls the callback with the flags.
+    //mode is passed to attachInterrupt: RISING, FALLING or CHANGE
+    //ACS37800_ERR_INTERRUPT_UNAVAILABLE is returned if a pin has no interrupt, or is already armed (e.g. by attachZeroCrossingInterrupt)
+    ACS37800ERR attachEventInterrupts(int dio0Pin, int dio1Pin, ACS37800_EVENT_CALLBACK callback, void *context = NULL,
+                                      ACS37800_INTERRUPT_MODE_t mode = CHANGE);
+    ACS37800ERR checkEvents(); // Call this regularly (e.g. once per pass of loop)
+    ACS37800ERR clearFaultLatch(); // Clear faultlatched by writing 1 to it in 0x2D
+    //Arm an interrupt on the MCU pin connected to DIO_0 when it is used for zero crossing. It calls notifyZeroCrossing.
+    //DIO_0 cannot be used for events as well: ACS37800_ERR_INTERRUPT_UNAVAILABLE is returned if the pin is already armed
+    ACS37800ERR attachZeroCrossingInterrupt(int dio0Pin, ACS37800_INTERRUPT_MODE_t mode = RISING);
+    void detachInterrupts(); // Detach all of the interrupts armed by this object
+
+    //Decode a raw snapshot using the supplied conversion factors (see getCalibration)
+    //This does not access the bus - it can be used in batch, or on a different machine
+    static void decode(const ACS37800_RAW_SNAPSHOT_t &snapshot, const ACS37800_CALIBRATION_t &calibration, ACS37800_DECODED_SNAPSHOT_t *decoded);
+
+    //Batch decoding of count instantaneous samples, held as separate arrays (vcodes, icodes and pinstant)
+    //These do not access the bus. Each channel is a simple loop, so GCC / Clang can vectorize them on hosts.
+    //Any of the input / output array pairs can be NULL to skip that channel. The arrays must not overlap.
+    //unpackInstantaneous splits raw 0x2A (and 0x2C) register contents into the code arrays
+    static void unpackInstantaneous(const uint32_t *reg2A, const uint32_t *reg2C, uint32_t count, int16_t *vCodes, int16_t *iCodes, int16_t *pCodes);
+    //Volts, Amps and Watts
+    static void decodeInstantaneous(const int16_t *vCodes, const int16_t *iCodes, const int16_t *pCodes, uint32_t count,
+                                    const ACS37800_CALIBRATION_t &calibration, float *volts, float *amps, float *watts);
+    //mV, mA and mW. The results are identical to applyFixedScale
+    static void decodeInstantaneousInt(const int16_t *vCodes, const int16_t *iCodes, const int16_t *pCodes, uint32_t count,
+                                       const ACS37800_CALIBRATION_t &calibration, int32_t *milliVolts, int32_t *milliAmps, int32_t *milliWatts);
+
+    //Integer-only versions of the above - for processors without an FPU
+    //Voltages are returned in mV, currents in mA, powers in mW / mVAR / mVA
+    //The power factor is returned in Q15 format (32768 = 1.0). pfactor is 11 bits with 10 fractional bits,
+    //so the range is -32768 (-1.0) to +32736 (1023/1024) in steps of 32
+    ACS37800ERR readRMSInt(int32_t *milliVolts, int32_t *milliAmps); // Read volatile register 0x20
+    ACS37800ERR readPowerActiveReactiveInt(int32_t *milliWatts, int32_t *milliVAR); // Read volatile register 0x21
+    ACS37800ERR readPowerFactorInt(int32_t *milliVA, int16_t *pFactorQ15, bool *posangle, bool *pospf); // Read volatile register 0x22
+    ACS37800ERR readInstantaneousInt(int32_t *milliVolts, int32_t *milliAmps, int32_t *milliWatts); // Read volatile registers 0x2A and 0x2C
+
+    //Generic access to any register field using the ACS37800_FIELD_ descriptors, e.g. getField<ACS37800_FIELD_N>(&n)
+    //getField reads configuration fields from _shadow_ memory (via the cache, if enabled). Signed fields are sign-extended.
+    //setField is for configuration fields only. It writes the shadow register, and the EEPROM register too if _eeprom is true.
+    template <class FIELD> ACS37800ERR getField(int32_t *value);
+    template <class FIELD> ACS37800ERR setField(int32_t value, bool _eeprom = false);
+    template <class FIELD> static void stageField(ACS37800_CONFIG_t *config, int32_t value, bool _eeprom = false);
+
+    //Apply an integer scale to a raw code
+    static int32_t applyFixedScale(int32_t code, const ACS37800_FIXED_SCALE_t &scale);
 
     //Change the parameters
     void setSenseRes(float newRes); // Change the value of _senseResistance (Ohms)
     void setDividerRes(float newRes); // Change the value of _dividerResistance (Ohms)
     void setCurrentRange(float newCurrent); // Change the value of _currentSensingRange (Amps)
 
+    //Return a copy of the conversion factors
+    void getCalibration(ACS37800_CALIBRATION_t *calibration);
+
+    //Asynchronous (non-blocking) register access
+    //The start functions return immediately. Call checkAsync regularly (e.g. once per pass of loop) to advance the operation.
+    //Each call of checkAsync performs at most one short I2C transaction. The 100ms settle time after a shadow/eeprom write
+    //is timed with millis() instead of delay(), so other tasks can run in the meantime.
+    //The optional callback is called (from checkAsync) when the operation completes. Only one operation can be in progress at a time.
+    ACS37800ERR startReadRegister(uint8_t address, ACS37800_ASYNC_CALLBACK callback = NULL, void *context = NULL);
+    ACS37800ERR startWriteRegister(uint32_t data, uint8_t address, ACS37800_ASYNC_CALLBACK callback = NULL, void *context = NULL);
+    ACS37800ERR startSetNumberOfSamples(uint32_t numberOfSamples, bool _eeprom = false, ACS37800_ASYNC_CALLBACK callback = NULL, void *context = NULL);
+    ACS37800ERR startSetBypassNenable(bool bypass, bool _eeprom = false, ACS37800_ASYNC_CALLBACK callback = NULL, void *context = NULL);
+    ACS37800ERR startCommitConfig(const ACS37800_CONFIG_t *config, ACS37800_ASYNC_CALLBACK callback = NULL, void *context = NULL);
+    ACS37800_ASYNC_STATUS_e checkAsync(); // Advance the operation. Returns ACS37800_ASYNC_COMPLETE (once) when it finishes
+    bool isAsyncBusy(); // Returns true if an operation is in progress
+    ACS37800ERR getAsyncResult(uint32_t *data = NULL); // Return the result (and data) of the last completed operation
+
   private:
 
     //This stores the requested i2c port
@@ -428,7 +934,16 @@ class ACS37800
 
     //Debug
     Stream *_debugPort; //The stream to send debug messages to if enabled. Usually Serial.
+#if ACS37800_DEBUG_LEVEL > 0
   	bool _printDebug = false; //Flag to print debugging variables
+#else
+    static const bool _printDebug = false; //Debug printing is compiled out. Every if (_printDebug == true) block is removed by the compiler
+#endif
+
+    //Error hook
+    ACS37800_ERROR_HOOK _errorHook = NULL;
+    void *_errorHookContext = NULL;
+    void reportError(ACS37800ERR error, uint8_t address, uint8_t detail); // Call the error hook (if any)
 
     //ACS37800's I2C address
     uint8_t _ACS37800Address = ACS37800_DEFAULT_I2C_ADDRESS;
@@ -444,6 +959,459 @@ class ACS37800
 
     //The ACS37800's coarse current gain - needed by the current calculations
     float _currentCoarseGain;
+
+    //The conversion factors. Rebuilt by updateCalibration whenever the resistances or current range change
+    ACS37800_CALIBRATION_t _calibration;
+    void updateCalibration();
+
+    //Settle policy
+    ACS37800_SETTLE_POLICY_e _settlePolicy = ACS37800_SETTLE_FIXED_DELAY;
+    unsigned long _settleTimeout = ACS37800_SETTLE_TIME_MS;
+    ACS37800ERR settle(const uint8_t *addresses, const uint32_t *data, uint8_t count); // Wait for data[i] to be written to addresses[i]
+    static bool writeComplete(uint8_t address, uint32_t data, uint32_t readback, unsigned long elapsed);
+    bool settleExpired(uint32_t data, unsigned long elapsed);
+
+    //Configuration transaction helpers
+    static void stageMasked(ACS37800_CONFIG_t *config, uint8_t shadowAddress, uint32_t mask, uint32_t value, bool _eeprom);
+    static uint8_t configAddress(uint8_t item);
+    static uint32_t configMask(const ACS37800_CONFIG_t *config, uint8_t item);
+    static uint8_t nextConfigItem(const ACS37800_CONFIG_t *config, uint8_t item);
+    static uint8_t configItem(uint8_t address); // The inverse of configAddress
+
+    //Shadow / EEPROM register cache. Indexed by configuration item
+    bool _cacheEnabled = false;
+    uint32_t _cache[10];
+    uint16_t _cacheValid = 0; // One bit per item: _cache[item] holds the register contents
+    uint16_t _cacheDirty = 0; // One bit per item: _cache[item] was written but has not been read back yet
+    ACS37800ERR readConfigRegister(uint32_t *data, uint8_t address); // Read from the cache if possible
+    void updateCache(uint8_t address, uint32_t data, bool dirty);
+
+    //Asynchronous operation state
+    typedef enum
+    {
+      ASYNC_STEP_IDLE = 0,
+      ASYNC_STEP_READ,
+      ASYNC_STEP_WRITE,
+      ASYNC_STEP_UNLOCK,
+      ASYNC_STEP_CONFIG_READ,
+      ASYNC_STEP_CONFIG_WRITE,
+      ASYNC_STEP_LOCK,
+      ASYNC_STEP_SETTLE
+    } ASYNC_STEP_e;
+    ASYNC_STEP_e _asyncStep = ASYNC_STEP_IDLE;
+    uint8_t _asyncAddress; // The register to read / write
+    uint32_t _asyncData; // The data read or to be written
+    ACS37800_CONFIG_t _asyncConfig; // For startCommitConfig, the staged changes
+    uint8_t _asyncItem; // For startCommitConfig, the configuration item (register) being written or checked
+    uint32_t _asyncWord; // For startCommitConfig, the register contents being modified
+    uint32_t _asyncWritten[10]; // For startCommitConfig, the words written. Indexed by configuration item
+    unsigned long _asyncTimer; // millis() at the start of the settle time
+    ACS37800ERR _asyncResult = ACS37800_SUCCESS;
+    ACS37800_ASYNC_CALLBACK _asyncCallback = NULL;
+    void *_asyncContext = NULL;
+    void finishAsync(ACS37800ERR result);
+
+    //pollMeasurements schedule. All times are micros()
+    bool _pollStarted = false;
+    unsigned long _pollPeriod = 0; // The update period of 0x20 - 0x22
+    unsigned long _pollUpdatedAt; // Estimated time of the last update
+    unsigned long _pollReadAt; // Time of the last read
+    unsigned long _pollNextRead; // Don't read before this
+    uint8_t _pollStale = 0; // Consecutive reads which returned unchanged registers
+    bool _pollLocked = false; // _pollUpdatedAt is known to within period / 16
+    uint8_t _pollUpdates; // Updates since numptsout was read
+    uint32_t _pollRegisters[3] = { 0, 0, 0 }; // Contents of 0x20 - 0x22 from the last read
+    ACS37800ERR readUpdatePeriod(); // Read numptsout. Set _pollPeriod
+
+    //pollAverages : when the one second [0] and one minute [1] averages were last read
+    unsigned long _averagesReadAt[2];
+    bool _averagesRead[2] = { false, false };
+
+    //Zero crossings notified by the DIO_0 interrupt
+    volatile uint8_t _zeroCrossings = 0;
+
+    //Event handling
+    //attachInterrupt cannot pass an object pointer to the interrupt routine. So each object using interrupts
+    //is given a slot in _interruptDevices, and the static routine for that slot finds the object.
+    static ACS37800 *_interruptDevices[ACS37800_MAX_EVENT_DEVICES];
+    int8_t _interruptSlot = -1; // This object's slot. -1 if none
+    int _eventPins[2] = { -1, -1 }; // The pins armed by attachEventInterrupts
+    int _zeroCrossingPin = -1; // The pin armed by attachZeroCrossingInterrupt
+    volatile bool _eventPending = false; // Set by the interrupt routine
+    ACS37800_EVENT_CALLBACK _eventCallback = NULL;
+    void *_eventContext = NULL;
+    ACS37800ERR allocateInterruptSlot();
+    ACS37800ERR checkInterruptPin(int pin, bool forEvents);
+    static void eventISR(uint8_t slot);
+    static void eventISR0();
+    static void eventISR1();
+    static void eventISR2();
+    static void eventISR3();
+    static void zeroCrossingISR(uint8_t slot);
+    static void zeroCrossingISR0();
+    static void zeroCrossingISR1();
+    static void zeroCrossingISR2();
+    static void zeroCrossingISR3();
+    ACS37800ERR readSample(ACS37800_WAVEFORM_SAMPLE_t *sample, bool includePower); // Read one waveform sample
+    static ACS37800_FIXED_SCALE_t calculateFixedScale(float unitsPerCode);
+    static void scaleCodes(const int16_t *__restrict codes, float *__restrict result, uint32_t count, float unitsPerCode); // Batch decode kernels
+    static void scaleCodesFixed(const int16_t *__restrict codes, int32_t *__restrict result, uint32_t count, const ACS37800_FIXED_SCALE_t &scale);
+
+    //Decode the contents of registers 0x20 - 0x22
+    static void decodeMeasurements(uint32_t reg20Data, uint32_t reg21Data, uint32_t reg22Data, const ACS37800_CALIBRATION_t &calibration, ACS37800_MEASUREMENTS_t *measurements);
+};
+
+//Read a register field. Configuration fields are read from _shadow_ memory
+template <class FIELD> ACS37800ERR ACS37800::getField(int32_t *value)
+{
+  uint32_t store;
+  ACS37800ERR error = readConfigRegister(&store, FIELD::address); // Volatile registers are read directly
+  if (error == ACS37800_SUCCESS)
+    *value = FIELD::extract(store);
+  return (error);
+}
+
+//Change a configuration field. One read-modify-write of the shadow register - and the EEPROM register if _eeprom is true
+template <class FIELD> ACS37800ERR ACS37800::setField(int32_t value, bool _eeprom)
+{
+  static_assert(FIELD::isConfig, "setField: only shadow / EEPROM fields can be set");
+  ACS37800_CONFIG_t config;
+  beginConfig(&config);
+  stageField<FIELD>(&config, value, _eeprom);
+  return (commitConfig(&config));
+}
+
+//Stage a change to a configuration field
+template <class FIELD> void ACS37800::stageField(ACS37800_CONFIG_t *config, int32_t value, bool _eeprom)
+{
+  static_assert(FIELD::isConfig, "stageField: only shadow / EEPROM fields can be staged");
+  stageMasked(config, FIELD::address, FIELD::mask, FIELD::insert(0, value), _eeprom);
+}
+
+//Energy metering : the power codes are integrated with 64-bit integer accumulators, so there is no loss of precision over time
+
+typedef struct
+{
+  int64_t activeImport; // |pactive| codes x milliseconds while pospf is true (consumed)
+  int64_t activeExport; // |pactive| codes x milliseconds while pospf is false (generated)
+  int64_t reactive; // pimag codes x milliseconds
+  int64_t apparent; // papparent codes x milliseconds
+  uint64_t elapsedMs; // The total time integrated
+} ACS37800_ENERGY_RAW_t;
+
+typedef struct
+{
+  double importWh; // Active energy consumed (Wh)
+  double exportWh; // Active energy generated (Wh)
+  double VARh; // Reactive energy (VARh)
+  double VAh; // Apparent energy (VAh)
+} ACS37800_ENERGY_t;
+
+class ACS37800EnergyMeter
+{
+  // User-accessible "public" interface
+  public:
+
+    //Read 0x21 and 0x22 from sensor and integrate the power since the previous update
+    //The first update only starts the clock. Call update regularly (e.g. every 100ms): each reading is applied to the whole interval since the previous one
+    ACS37800ERR update(ACS37800 &sensor);
+
+    //Integrate the contents of registers 0x21 and 0x22 (e.g. from readRaw) read at timestamp (millis())
+    void accumulate(uint32_t reg21Data, uint32_t reg22Data, unsigned long timestamp);
+
+    void getRaw(ACS37800_ENERGY_RAW_t *raw); // Return the raw totals - e.g. to save them in non-volatile memory
+    void setRaw(const ACS37800_ENERGY_RAW_t &raw); // Restore the raw totals
+    void reset(); // Clear the totals and restart the clock
+
+    //Convert the totals to Wh / VARh / VAh using the conversion factors (see getCalibration)
+    void getEnergy(const ACS37800_CALIBRATION_t &calibration, ACS37800_ENERGY_t *energy);
+
+  private:
+
+    ACS37800_ENERGY_RAW_t _totals = { 0, 0, 0, 0, 0 };
+    unsigned long _lastTimestamp = 0;
+    bool _started = false; // True once the clock has been started
+};
+
+//Report by exception : vrms, irms and pactive are only reported when they move outside a deadband
+//The comparisons use the raw codes, so there is no float math unless something is reported
+
+typedef enum
+{
+  ACS37800_DEADBAND_VRMS = 0,
+  ACS37800_DEADBAND_IRMS,
+  ACS37800_DEADBAND_PACTIVE
+} ACS37800_DEADBAND_QUANTITY_e;
+
+const uint8_t ACS37800_DEADBAND_HEARTBEAT = 0x80; // changed bit: reported because of the heartbeat (maximum silence)
+
+typedef struct
+{
+  uint8_t changed; // Bit (1 << ACS37800_DEADBAND_QUANTITY_e) is set for each quantity outside its deadband. Plus ACS37800_DEADBAND_HEARTBEAT
+  unsigned long timestamp; // millis() when the registers were read
+  float vRMS; // Volts
+  float iRMS; // Amps
+  float pActive; // Watts
+} ACS37800_DEADBAND_REPORT_t;
+
+class ACS37800Deadband
+{
+  // User-accessible "public" interface
+  public:
+
+    //Set the deadband for one quantity. A change is reported when the code moves from the last reported code by more than
+    //the larger of absoluteCodes and relativePerMille / 1000 of the last reported code
+    //With both zero (the default) every change is reported. Use the conversion factors (see getCalibration) to convert
+    //units to codes, e.g. 0.5 / calibration.voltsPerCodeRMS for 0.5V
+    void setDeadband(ACS37800_DEADBAND_QUANTITY_e quantity, uint16_t absoluteCodes, uint16_t relativePerMille = 0);
+
+    //Report everything if nothing has been reported for maxSilenceMs. 0 (the default) disables the heartbeat
+    void setHeartbeat(unsigned long maxSilenceMs);
+
+    //Read 0x20 and 0x21 from sensor. If anything is outside its deadband, decode everything into report and set reported to true
+    //Otherwise report is not changed
+    ACS37800ERR update(ACS37800 &sensor, ACS37800_DEADBAND_REPORT_t *report, bool *reported);
+
+    //Compare the contents of registers 0x20 and 0x21 (e.g. from readRaw) read at timestamp (millis()) - no float math
+    //Returns the changed bits (see ACS37800_DEADBAND_REPORT_t). Zero if nothing needs to be reported
+    //The reported quantities become the new reference. The first check reports everything
+    uint8_t check(uint32_t reg20Data, uint32_t reg21Data, unsigned long timestamp);
+
+    void reset(); // Report everything on the next check
+
+  private:
+
+    uint16_t _absolute[3] = { 0, 0, 0 };
+    uint16_t _relative[3] = { 0, 0, 0 }; // Per mille
+    int32_t _reference[3] = { 0, 0, 0 }; // The last reported codes
+    unsigned long _maxSilence = 0;
+    unsigned long _lastReport = 0;
+    bool _started = false; // True once something has been reported
+};
+
+//Windowed statistics of vrms, irms and pactive : min, max, mean, variance and percentiles
+//The raw codes are accumulated with integer math only. Constant memory: the percentiles come from a small histogram per quantity
+
+const uint8_t ACS37800_STATISTICS_BINS = 16; // Histogram bins per quantity
+
+typedef enum
+{
+  ACS37800_STATISTICS_VRMS = 0,
+  ACS37800_STATISTICS_IRMS,
+  ACS37800_STATISTICS_PACTIVE
+} ACS37800_STATISTICS_QUANTITY_e;
+
+//Statistics of one quantity over one window. All values are in codes: multiply by the conversion factor (see getCalibration)
+//(variance by its square) to convert to units
+typedef struct
+{
+  uint32_t count; // The number of samples. The other values are only valid if this is non-zero
+  int32_t min;
+  int32_t max;
+  float mean;
+  float variance; // Population variance
+  unsigned long start; // millis() at the start of the window
+} ACS37800_STATISTICS_t;
+
+class ACS37800Statistics
+{
+  // User-accessible "public" interface
+  public:
+
+    //Set the window length. When a sample arrives after the end of the window, the window is completed and a new one starts.
+    //Windows are consecutive: each starts windowMs after the previous one. 0 (the default) = only rollover completes a window
+    void setWindow(unsigned long windowMs);
+
+    //Set the histogram range of the current window (codes) and restart the quantity's window. Samples outside it are counted in the end bins
+    //By default the first window covers the whole code range. Each later window uses the range of the previous one, plus a margin
+    void setRange(ACS37800_STATISTICS_QUANTITY_e quantity, int32_t minCode, int32_t maxCode);
+
+    //Read 0x20 and 0x21 from sensor and add them. completed is set to true if a window was completed
+    ACS37800ERR update(ACS37800 &sensor, bool *completed);
+
+    //Add the contents of registers 0x20 and 0x21 (e.g. from readRaw) read at timestamp (millis()). Integer math only.
+    //Returns true if a window was completed (before this sample was added)
+    bool add(uint32_t reg20Data, uint32_t reg21Data, unsigned long timestamp);
+
+    void rollover(unsigned long timestamp); // Complete the current window now. The next one starts at timestamp
+
+    //Return the statistics of the last completed window - or of the window in progress if current is true
+    void getStatistics(ACS37800_STATISTICS_QUANTITY_e quantity, ACS37800_STATISTICS_t *statistics, bool current = false);
+
+    //Return the estimated percentile (perMille = 500 for the median, 950 for the 95th percentile) in codes
+    //The estimate is interpolated within a histogram bin and limited to min and max
+    int32_t getPercentile(ACS37800_STATISTICS_QUANTITY_e quantity, uint16_t perMille, bool current = false);
+
+  private:
+
+    typedef struct
+    {
+      uint32_t count;
+      int32_t min;
+      int32_t max;
+      int32_t offset; // The first sample. Subtracted before summing, to keep the sums small and the variance accurate
+      int64_t sum; // Sum of (code - offset)
+      uint64_t sumSquares; // Sum of (code - offset)^2
+      int32_t low; // Histogram : the lowest code of bin 0
+      uint8_t binShift; // Histogram : each bin is (1 << binShift) codes wide
+      uint32_t bins[ACS37800_STATISTICS_BINS];
+    } ACS37800_ACCUMULATOR_t;
+
+    ACS37800_ACCUMULATOR_t _current[3];
+    ACS37800_ACCUMULATOR_t _completed[3];
+    unsigned long _windowMs = 0;
+    unsigned long _windowStart = 0;
+    unsigned long _completedStart = 0;
+    bool _started = false; // True once the first sample has been added
+    bool _ranged[3] = { false, false, false }; // True if setRange has been called for the current window
+
+    static void clearAccumulator(ACS37800_ACCUMULATOR_t *accumulator);
+    static void setAccumulatorRange(ACS37800_ACCUMULATOR_t *accumulator, int32_t minCode, int32_t maxCode);
+    static void accumulate(ACS37800_ACCUMULATOR_t *accumulator, int32_t code);
+    static int32_t percentile(const ACS37800_ACCUMULATOR_t *accumulator, uint16_t perMille);
+};
+
+//Power quality : sags, swells and interruptions, detected from the half-cycle RMS voltage
+//The source is either vrms (0x20) with halfcycle_en set - setField<ACS37800_FIELD_HALFCYCLE_EN>(1) - or vcodes (0x2A),
+//squared and summed over each half cycle in software. Integer math and constant time per sample
+
+const uint8_t ACS37800_PQ_MAX_EVENTS = 8; // The size of the event log
+const unsigned long ACS37800_PQ_MIN_HALF_CYCLE = 4000; // vcodes : zero crossings closer than this (us) are noise
+const unsigned long ACS37800_PQ_MAX_HALF_CYCLE = 20000; // vcodes : without a zero crossing, a half cycle ends after this (us)
+
+typedef enum
+{
+  ACS37800_PQ_NONE = 0,
+  ACS37800_PQ_SAG, // Below the sag threshold
+  ACS37800_PQ_SWELL, // Above the swell threshold
+  ACS37800_PQ_INTERRUPTION // A sag which went below the interruption threshold
+} ACS37800_PQ_EVENT_TYPE_e;
+
+typedef struct
+{
+  ACS37800_PQ_EVENT_TYPE_e type;
+  unsigned long start; // micros() at the start of the first half cycle outside the threshold
+  uint32_t duration; // us. Wraps after 71 minutes
+  uint16_t extreme; // The lowest (sag, interruption) or highest (swell) half-cycle RMS, in codes of the source
+} ACS37800_PQ_EVENT_t;
+
+class ACS37800PowerQuality
+{
+  // User-accessible "public" interface
+  public:
+
+    //Set the nominal RMS voltage in codes of the source: e.g. 230.0 / calibration.voltsPerCodeRMS (vrms)
+    //or 230.0 / calibration.voltsPerCodeInst (vcodes). No events are detected until this is set
+    void setNominal(uint16_t nominalCodes);
+
+    //Set the thresholds in parts per thousand of the nominal. An event ends when the voltage is back inside its threshold
+    //by more than hysteresisPerMille. The defaults are a sag below 900, a swell above 1100, an interruption below 100, hysteresis 20
+    void setThresholds(uint16_t sagPerMille, uint16_t swellPerMille, uint16_t interruptionPerMille, uint16_t hysteresisPerMille);
+
+    //Read 0x20 from sensor (which should have halfcycle_en set) and add it. logged is set to true if an event was logged
+    //Call at least once per half cycle: repeated readings of the same half cycle do no harm
+    ACS37800ERR update(ACS37800 &sensor, bool *logged);
+
+    //Add the contents of register 0x20 (vrms), read at timestamp (micros()). Returns true if an event was logged
+    bool addRMS(uint32_t reg20Data, unsigned long timestamp);
+
+    //Add the contents of register 0x2A (vcodes), read at timestamp (micros()). Returns true if an event was logged
+    //Call at the full capture rate: the half cycles are found from the zero crossings
+    bool addInstantaneous(uint32_t reg2AData, unsigned long timestamp);
+    bool addSample(const ACS37800_WAVEFORM_SAMPLE_t &sample); // As above, for a sample captured by captureInstantaneous or captureCycles (popped from the ACS37800WaveformBuffer)
+
+    bool pop(ACS37800_PQ_EVENT_t *event); // Remove the oldest logged event. Returns false if the log is empty
+    uint8_t available(); // The number of events in the log
+    uint32_t getOverruns(); // The number of events overwritten before they were popped
+    bool getActive(ACS37800_PQ_EVENT_t *event); // Copy the event in progress (duration so far). Returns false if there is none
+    void reset(); // End any event without logging it, empty the log and wait for the next half cycle
+
+  private:
+
+    uint16_t _nominal = 0;
+    uint16_t _sagPerMille = 900;
+    uint16_t _swellPerMille = 1100;
+    uint16_t _interruptionPerMille = 100;
+    uint16_t _hysteresisPerMille = 20;
+
+    //The thresholds in codes, calculated by setNominal and setThresholds
+    uint32_t _sagStart = 0; // Below this : a sag starts
+    uint32_t _sagEnd = 0; // At or above this : a sag or interruption ends
+    uint32_t _swellStart = 0xFFFFFFFF; // Above this : a swell starts
+    uint32_t _swellEnd = 0xFFFFFFFF; // At or below this : a swell ends
+    uint32_t _interruption = 0; // Below this : a sag becomes an interruption
+
+    ACS37800_PQ_EVENT_t _active = { ACS37800_PQ_NONE, 0, 0, 0 };
+    unsigned long _lastTimestamp = 0;
+
+    //vcodes half cycles
+    bool _halfCycleStarted = false; // False until the first zero crossing
+    bool _positive = false;
+    unsigned long _halfCycleStart = 0;
+    uint32_t _halfCycleSamples = 0;
+    uint64_t _halfCycleSquares = 0;
+
+    ACS37800_PQ_EVENT_t _log[ACS37800_PQ_MAX_EVENTS];
+    uint8_t _head = 0; // Where the next event will be written
+    uint8_t _count = 0;
+    uint32_t _overruns = 0;
+
+    void calculateThresholds();
+    bool classify(uint16_t rms, unsigned long timestamp); // Process one half-cycle RMS. Returns true if an event was logged
+    void startEvent(uint16_t rms, unsigned long timestamp); // Start an event if rms is outside the thresholds
+    void logEvent(unsigned long end);
+    static uint32_t sqrt32(uint32_t value); // Integer square root
+};
+
+//Multi-device manager : polls several ACS37800s, on one or more I2C buses
+
+const uint8_t ACS37800_FLEET_MAX_DEVICES = 12; // The maximum number of devices per fleet
+
+typedef enum
+{
+  ACS37800_FLEET_ROUND_ROBIN = 0, // Read the devices in the order they were added (the default)
+  ACS37800_FLEET_INTERLEAVE_BUSES // Alternate between the buses: one device from each bus in turn
+} ACS37800_FLEET_ORDER_e;
+
+typedef struct
+{
+  uint8_t device; // The device index (as returned by addDevice)
+  unsigned long timestamp; // millis() when the device was read
+  ACS37800ERR error; // The readMeasurements result. measurements is only valid if this is ACS37800_SUCCESS
+  ACS37800_MEASUREMENTS_t measurements;
+} ACS37800_FLEET_RESULT_t;
+
+class ACS37800Fleet
+{
+  // User-accessible "public" interface
+  public:
+
+    //Add a device to the fleet. Call the device's begin first, so its I2C port and address are known.
+    //Returns the device index, or -1 if the fleet is full. The device object must persist.
+    int8_t addDevice(ACS37800 &device);
+    uint8_t getDeviceCount();
+    ACS37800 *getDevice(uint8_t index); // Returns NULL if index is invalid
+
+    //Select the order in which the devices are read
+    void setOrder(ACS37800_FLEET_ORDER_e order);
+
+    //Read every device once (readMeasurements) in schedule order. results must have room for getDeviceCount() entries.
+    //Returns the number of results.
+    uint8_t pollCycle(ACS37800_FLEET_RESULT_t *results);
+
+    //Read only the next device in the schedule - to spread a cycle over several passes of loop
+    //Returns true when this read completes a cycle
+    bool pollNext(ACS37800_FLEET_RESULT_t *result);
+
+  private:
+
+    ACS37800 *_devices[ACS37800_FLEET_MAX_DEVICES];
+    uint8_t _deviceCount = 0;
+    uint8_t _schedule[ACS37800_FLEET_MAX_DEVICES]; // The device indexes in the order they are to be read
+    uint8_t _nextRead = 0; // The position in _schedule of the next device to be read
+    ACS37800_FLEET_ORDER_e _order = ACS37800_FLEET_ROUND_ROBIN;
+
+    void buildSchedule();
 };
 
 #endif
@@ -0,0 +1,277 @@
+/*
+  Compact binary record format for logging ACS37800 measurements
+
+  https://github.com/sparkfun/SparkFun_ACS37800_Power_Monitor_Arduino_Library
+
+  Plain C++ with no Arduino dependencies. See SparkFun_ACS37800_Record.h for the record layout.
+
+  SparkFun labored with love to create this code. Feel like supporting open
+  source hardware? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/17873
+
+*/
+
+#include "SparkFun_ACS37800_Record.h"
+
+//The number of 16-bit fields recorded for each ACS37800_RECORD_CONTENT_e bit
+static const uint8_t ACS37800_RECORD_FIELDS[6] = { 2, 2, 2, 2, 1, 1 };
+
+//The recorded bits of each register
+static const uint32_t ACS37800_RECORD_MASKS[6] = { 0xFFFFFFFF, 0xFFFFFFFF, 0x1FFFFFFF, 0xFFFFFFFF, 0x0000FFFF, 0x0000FFFF };
+
+//Return a pointer to the record member for content bit (in ACS37800_RECORD_CONTENT_e order)
+static uint32_t *recordRegister(ACS37800_RECORD_t *record, uint8_t bit)
+{
+  switch (bit)
+  {
+    case 0: return (&record->reg20);
+    case 1: return (&record->reg21);
+    case 2: return (&record->reg22);
+    case 3: return (&record->reg2A);
+    case 4: return (&record->reg2C);
+    default: return (&record->reg2D);
+  }
+}
+
+//CRC-16/CCITT-FALSE
+uint16_t ACS37800RecordCRC(const uint8_t *data, size_t length)
+{
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc ^= ((uint16_t)data[i]) << 8;
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return (crc);
+}
+
+//Constructor
+ACS37800RecordEncoder::ACS37800RecordEncoder(uint16_t keyInterval)
+{
+  _keyInterval = keyInterval;
+  reset();
+}
+
+//The next record has an absolute timestamp
+void ACS37800RecordEncoder::reset()
+{
+  _sinceKey = 0;
+  _lastTimestamp = 0;
+}
+
+//Encode record into buffer. Returns the number of bytes
+size_t ACS37800RecordEncoder::encode(const ACS37800_RECORD_t &record, uint8_t *buffer)
+{
+  uint8_t contents = record.contents & ACS37800_RECORD_ALL;
+  uint32_t timestamp = record.timestamp - _lastTimestamp; // Unsigned subtraction copes with the micros() roll-over
+  if (_sinceKey == 0)
+  {
+    contents |= ACS37800_RECORD_ABSOLUTE;
+    timestamp = record.timestamp;
+  }
+  _lastTimestamp = record.timestamp;
+  if (_keyInterval == 0)
+    _sinceKey = 1; // Only the first record is absolute
+  else if (++_sinceKey >= _keyInterval)
+    _sinceKey = 0; // Absolute next time
+
+  size_t length = 0;
+  buffer[length++] = ACS37800_RECORD_SYNC_1;
+  buffer[length++] = ACS37800_RECORD_SYNC_2;
+  buffer[length++] = ACS37800_RECORD_VERSION;
+  buffer[length++] = contents;
+  buffer[length++] = record.deviceId;
+
+  do // Varint timestamp
+  {
+    uint8_t b = timestamp & 0x7F;
+    timestamp >>= 7;
+    buffer[length++] = (timestamp > 0) ? b | 0x80 : b;
+  } while (timestamp > 0);
+
+  const uint32_t registers[6] = { record.reg20, record.reg21, record.reg22, record.reg2A, record.reg2C, record.reg2D };
+  for (uint8_t bit = 0; bit < 6; bit++)
+  {
+    if ((contents & (1 << bit)) == 0)
+      continue;
+    uint32_t data = registers[bit] & ACS37800_RECORD_MASKS[bit];
+    for (uint8_t field = 0; field < ACS37800_RECORD_FIELDS[bit]; field++)
+    {
+      buffer[length++] = data & 0xFF;
+      buffer[length++] = (data >> 8) & 0xFF;
+      data >>= 16;
+    }
+  }
+
+  uint16_t crc = ACS37800RecordCRC(&buffer[2], length - 2); // From version to the end of the fields
+  buffer[length++] = crc & 0xFF;
+  buffer[length++] = crc >> 8;
+
+  return (length);
+}
+
+//Constructor
+ACS37800RecordDecoder::ACS37800RecordDecoder()
+{
+  _crcErrors = 0;
+  _unsynced = 0;
+  reset();
+}
+
+//Discard any partial record. Wait for an absolute timestamp
+void ACS37800RecordDecoder::reset()
+{
+  _length = 0;
+  _synced = false;
+  _lastTimestamp = 0;
+}
+
+uint32_t ACS37800RecordDecoder::getCRCErrors()
+{
+  return (_crcErrors);
+}
+
+uint32_t ACS37800RecordDecoder::getUnsynced()
+{
+  return (_unsynced);
+}
+
+//Add one byte. Returns true when record holds a complete, valid record
+bool ACS37800RecordDecoder::decode(uint8_t byte, ACS37800_RECORD_t *record)
+{
+  if ((_length == 0) && (byte != ACS37800_RECORD_SYNC_1))
+  {
+    _synced = false; // Records are back to back. A stray byte means a record (and its delta) may have been lost
+    return (false); // Hunting for the sync
+  }
+
+  if (_length >= ACS37800_RECORD_MAX_SIZE)
+    discard(1); // Should never happen - a full buffer always parses
+  _buffer[_length++] = byte;
+
+  while (_length > 0)
+  {
+    int8_t result = parse(record);
+
+    if (result == 0)
+      return (false); // Need more bytes
+
+    if (result < 0)
+    {
+      if (result == -2)
+        _crcErrors++;
+      _synced = false; // A delta may have been lost
+      discard(1); // Try again from the next sync byte
+      continue;
+    }
+
+    bool valid = true;
+    if (record->contents & ACS37800_RECORD_ABSOLUTE)
+    {
+      _lastTimestamp = record->timestamp;
+      _synced = true;
+    }
+    else if (_synced)
+    {
+      _lastTimestamp += record->timestamp;
+      record->timestamp = _lastTimestamp;
+    }
+    else
+    {
+      _unsynced++;
+      valid = false; // Can't use this one
+    }
+
+    discard(result);
+
+    if (valid)
+    {
+      record->contents &= ACS37800_RECORD_ALL;
+      return (true);
+    }
+  }
+
+  return (false);
+}
+
+//Parse the buffer. Returns the record length, 0 if incomplete, -1 if not a record, -2 if corrupt
+int8_t ACS37800RecordDecoder::parse(ACS37800_RECORD_t *record)
+{
+  if (_length < 2)
+    return (0);
+  if ((_buffer[0] != ACS37800_RECORD_SYNC_1) || (_buffer[1] != ACS37800_RECORD_SYNC_2))
+    return (-1);
+  if (_length < 5)
+    return (0);
+  if ((_buffer[2] != ACS37800_RECORD_VERSION) || (_buffer[3] & ~(ACS37800_RECORD_ALL | ACS37800_RECORD_ABSOLUTE)))
+    return (-2);
+
+  uint8_t length = 5;
+  uint32_t timestamp = 0;
+  for (uint8_t shift = 0; ; shift += 7) // Varint timestamp
+  {
+    if (length >= _length)
+      return (0);
+    if (shift > 28)
+      return (-2); // Too long
+    uint8_t b = _buffer[length++];
+    timestamp |= ((uint32_t)(b & 0x7F)) << shift;
+    if ((b & 0x80) == 0)
+      break;
+  }
+
+  uint8_t fieldsStart = length;
+  for (uint8_t bit = 0; bit < 6; bit++)
+    if (_buffer[3] & (1 << bit))
+      length += ACS37800_RECORD_FIELDS[bit] * 2;
+  length += 2; // CRC
+
+  if (_length < length)
+    return (0);
+
+  uint16_t crc = ACS37800RecordCRC(&_buffer[2], length - 4);
+  if ((_buffer[length - 2] != (crc & 0xFF)) || (_buffer[length - 1] != (crc >> 8)))
+    return (-2);
+
+  record->contents = _buffer[3];
+  record->deviceId = _buffer[4];
+  record->timestamp = timestamp;
+  record->reg20 = 0;
+  record->reg21 = 0;
+  record->reg22 = 0;
+  record->reg2A = 0;
+  record->reg2C = 0;
+  record->reg2D = 0;
+
+  uint8_t *field = &_buffer[fieldsStart];
+  for (uint8_t bit = 0; bit < 6; bit++)
+  {
+    if ((_buffer[3] & (1 << bit)) == 0)
+      continue;
+    uint32_t data = 0;
+    for (uint8_t i = 0; i < ACS37800_RECORD_FIELDS[bit]; i++)
+    {
+      data |= ((uint32_t)field[0] | ((uint32_t)field[1] << 8)) << (16 * i);
+      field += 2;
+    }
+    *recordRegister(record, bit) = data;
+  }
+
+  return (length);
+}
+
+//Remove count bytes from the buffer and skip to the next sync byte
+void ACS37800RecordDecoder::discard(uint8_t count)
+{
+  while ((count < _length) && (_buffer[count] != ACS37800_RECORD_SYNC_1))
+  {
+    count++;
+    _synced = false; // A stray byte
+  }
+  if (count > _length)
+    count = _length;
+  for (uint8_t i = count; i < _length; i++)
+    _buffer[i - count] = _buffer[i];
+  _length -= count;
+}
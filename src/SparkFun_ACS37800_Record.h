@@ -0,0 +1,120 @@
+/*
+  Compact binary record format for logging ACS37800 measurements
+
+  https://github.com/sparkfun/SparkFun_ACS37800_Power_Monitor_Arduino_Library
+
+  This file (and SparkFun_ACS37800_Record.cpp) is plain C++ with no Arduino dependencies.
+  Copy both files to a host (PC, gateway) and compile them there to decode the records.
+  ACS37800::writeRecord encodes and writes the records on the Arduino side.
+
+  Record layout (version 1). Multi-byte values are little endian:
+    0xAC 0x37 : sync
+    version   : ACS37800_RECORD_VERSION
+    contents  : ACS37800_RECORD_CONTENT_e bits - which registers follow. Bit 7 set = absolute timestamp
+    device id : chosen by the writer
+    timestamp : microseconds, as a varint (7 bits per byte, LS first, bit 7 set = more bytes follow)
+                Absolute, or the delta from the previous record in the stream
+    fields    : the raw 16-bit register fields, in order:
+                0x20 : vrms, irms
+                0x21 : pactive, pimag
+                0x22 : papparent, bits 16-28 (pfactor, posangle, pospf)
+                0x2A : vcodes, icodes
+                0x2C : pinstant
+                0x2D : bits 0-15 (the error flags)
+    CRC       : CRC-16/CCITT-FALSE of everything from version to the end of the fields
+
+  A record is 8 to 32 bytes. RMS + power + power factor with a 1-2 byte delta is 20 - 21 bytes.
+  Records must be written back to back. The decoder treats any other bytes as lost data: it discards the delta records
+  which follow, until the next absolute timestamp.
+
+  SparkFun labored with love to create this code. Feel like supporting open
+  source hardware? Buy a board from SparkFun!
+  https://www.sparkfun.com/products/17873
+
+*/
+
+#ifndef SparkFun_ACS37800_Record_h
+#define SparkFun_ACS37800_Record_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+const uint8_t ACS37800_RECORD_SYNC_1 = 0xAC;
+const uint8_t ACS37800_RECORD_SYNC_2 = 0x37;
+const uint8_t ACS37800_RECORD_VERSION = 1;
+const uint8_t ACS37800_RECORD_MAX_SIZE = 32; // sync(2) + version + contents + id + timestamp(5) + fields(20) + CRC(2)
+const uint8_t ACS37800_RECORD_ABSOLUTE = 0x80; // contents bit 7 : the timestamp is absolute
+
+//Which registers a record contains
+typedef enum
+{
+  ACS37800_RECORD_RMS = 0x01, // 0x20
+  ACS37800_RECORD_POWER = 0x02, // 0x21
+  ACS37800_RECORD_POWER_FACTOR = 0x04, // 0x22
+  ACS37800_RECORD_INSTANTANEOUS = 0x08, // 0x2A
+  ACS37800_RECORD_INSTANTANEOUS_POWER = 0x10, // 0x2C
+  ACS37800_RECORD_ERROR_FLAGS = 0x20, // 0x2D
+  ACS37800_RECORD_ALL = 0x3F
+} ACS37800_RECORD_CONTENT_e;
+
+//One record. The registers not selected by contents are zero.
+//The register contents are restored exactly as read, except for the bits which are not recorded (0x22 bits 29-31, 0x2D bits 16-31)
+typedef struct
+{
+  uint8_t deviceId;
+  uint8_t contents; // ACS37800_RECORD_CONTENT_e bits
+  uint32_t timestamp; // micros()
+  uint32_t reg20;
+  uint32_t reg21;
+  uint32_t reg22;
+  uint32_t reg2A;
+  uint32_t reg2C;
+  uint32_t reg2D;
+} ACS37800_RECORD_t;
+
+//Encode records. One encoder per stream: the timestamps are delta-encoded against the previous record
+class ACS37800RecordEncoder
+{
+  public:
+    //Every keyInterval records the timestamp is absolute, so a decoder can recover from lost bytes. 0 = only the first record
+    ACS37800RecordEncoder(uint16_t keyInterval = 64);
+
+    //Encode record into buffer (at least ACS37800_RECORD_MAX_SIZE bytes). Returns the number of bytes
+    size_t encode(const ACS37800_RECORD_t &record, uint8_t *buffer);
+    void reset(); // The next record has an absolute timestamp
+
+  private:
+    uint16_t _keyInterval;
+    uint16_t _sinceKey;
+    uint32_t _lastTimestamp;
+};
+
+//Decode records from a byte stream. Feed it the bytes in any sized pieces
+class ACS37800RecordDecoder
+{
+  public:
+    ACS37800RecordDecoder();
+
+    //Add one byte. Returns true when record holds a complete, valid record
+    bool decode(uint8_t byte, ACS37800_RECORD_t *record);
+    void reset(); // Discard any partial record. Wait for an absolute timestamp
+
+    uint32_t getCRCErrors(); // Records discarded because of a bad CRC (or unknown version)
+    uint32_t getUnsynced(); // Valid delta records discarded because no absolute timestamp has been seen since the last error
+
+  private:
+    uint8_t _buffer[ACS37800_RECORD_MAX_SIZE];
+    uint8_t _length;
+    bool _synced;
+    uint32_t _lastTimestamp;
+    uint32_t _crcErrors;
+    uint32_t _unsynced;
+
+    int8_t parse(ACS37800_RECORD_t *record); // Returns the record length, 0 if incomplete, -1 if not a record, -2 if corrupt
+    void discard(uint8_t count); // Remove count bytes from the buffer and skip to the next sync byte
+};
+
+//CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+uint16_t ACS37800RecordCRC(const uint8_t *data, size_t length);
+
+#endif
@@ -0,0 +1,118 @@
+/*
+  Host build of the SparkFun ACS37800 library : a minimal Arduino.h
+
+  Just enough of the Arduino core for SparkFun_ACS37800_Arduino_Library.cpp to build and run on a PC.
+  Time is virtual (see ArduinoHost.h): it only moves when delay() is called or the fake TwoWire performs a transaction.
+  Interrupts are simulated: pins 2 and 3 are interrupts 0 and 1, like an Uno. hostFireInterrupt calls the routine.
+  Define ACS37800_HOST_ARDUINO_API to emulate an ArduinoCore-API core, where the interrupt mode is a PinStatus enum.
+
+  Not for use on an Arduino!
+*/
+
+#ifndef ACS37800_HOST_ARDUINO_H
+#define ACS37800_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HEX 16
+#define DEC 10
+#define OCT 8
+#define BIN 2
+
+#define PI 3.1415926535897932384626433832795
+
+#define NOT_AN_INTERRUPT -1
+
+#if defined(ACS37800_HOST_ARDUINO_API)
+#define ARDUINO_API_VERSION 10001
+typedef enum {
+  LOW = 0,
+  HIGH = 1,
+  CHANGE = 2,
+  FALLING = 3,
+  RISING = 4
+} PinStatus;
+typedef PinStatus HOST_INTERRUPT_MODE_t;
+#else
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+typedef int HOST_INTERRUPT_MODE_t;
+#endif
+
+//Flash strings are ordinary strings on a PC
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) { return (write((const uint8_t *)str, strlen(str))); }
+
+    size_t print(const __FlashStringHelper *str) { return (write(reinterpret_cast<const char *>(str))); }
+    size_t print(const char *str) { return (write(str)); }
+    size_t print(char c) { return (write((uint8_t)c)); }
+    size_t print(unsigned char value, int base = DEC) { return (printNumber(value, base)); }
+    size_t print(int value, int base = DEC) { return (printSigned(value, base)); }
+    size_t print(unsigned int value, int base = DEC) { return (printNumber(value, base)); }
+    size_t print(long value, int base = DEC) { return (printSigned(value, base)); }
+    size_t print(unsigned long value, int base = DEC) { return (printNumber(value, base)); }
+    size_t print(long long value, int base = DEC) { return (printSigned(value, base)); }
+    size_t print(unsigned long long value, int base = DEC) { return (printNumber(value, base)); }
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return (write("\r\n")); }
+    template <typename T> size_t println(T value) { return (print(value) + println()); }
+    template <typename T> size_t println(T value, int format) { return (print(value, format) + println()); }
+
+  private:
+    size_t printSigned(long long value, int base);
+    size_t printNumber(unsigned long long value, int base);
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+//Serial writes to stdout
+class HardwareSerial : public Stream
+{
+  public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t write(uint8_t c);
+    using Print::write;
+    int available() { return (0); }
+    int read() { return (-1); }
+    int peek() { return (-1); }
+};
+
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), HOST_INTERRUPT_MODE_t mode);
+void detachInterrupt(uint8_t interruptNum);
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+void interrupts();
+void noInterrupts();
+
+#include "ArduinoHost.h"
+
+#endif
@@ -0,0 +1,149 @@
+/*
+  Host build of the SparkFun ACS37800 library : the Arduino core functions
+*/
+
+#include "Arduino.h"
+#include <stdio.h>
+
+HardwareSerial Serial;
+
+static uint64_t _nanos = 0;
+
+static const uint8_t HOST_INTERRUPTS = 2;
+static void (*_isr[HOST_INTERRUPTS])(void);
+static int _isrMode[HOST_INTERRUPTS];
+
+//Print
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (size--)
+    n += write(*buffer++);
+  return (n);
+}
+
+size_t Print::printSigned(long long value, int base)
+{
+  if ((value < 0) && (base == DEC))
+    return (write('-') + printNumber(0ULL - (unsigned long long)value, base));
+  return (printNumber((unsigned long long)value, base));
+}
+
+size_t Print::printNumber(unsigned long long value, int base)
+{
+  char buffer[65];
+  char *p = &buffer[64];
+  *p = 0;
+  if (base < 2)
+    base = DEC;
+  do
+  {
+    int digit = value % base;
+    *--p = (digit < 10) ? '0' + digit : 'A' + digit - 10;
+    value /= base;
+  } while (value > 0);
+  return (write(p));
+}
+
+size_t Print::print(double value, int digits)
+{
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+  return (write(buffer));
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  return (fputc(c, stdout) == EOF ? 0 : 1);
+}
+
+//Time
+
+uint64_t hostNanos()
+{
+  return (_nanos);
+}
+
+void hostSetMicros(uint64_t us)
+{
+  _nanos = us * 1000;
+}
+
+void hostAdvanceNanos(uint64_t ns)
+{
+  _nanos += ns;
+}
+
+unsigned long millis()
+{
+  return ((unsigned long)(_nanos / 1000000));
+}
+
+unsigned long micros()
+{
+  return ((unsigned long)(_nanos / 1000));
+}
+
+void delay(unsigned long ms)
+{
+  _nanos += (uint64_t)ms * 1000000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  _nanos += (uint64_t)us * 1000;
+}
+
+void yield()
+{
+}
+
+//Interrupts
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), HOST_INTERRUPT_MODE_t mode)
+{
+  if (interruptNum >= HOST_INTERRUPTS)
+    return;
+  _isr[interruptNum] = userFunc;
+  _isrMode[interruptNum] = (int)mode;
+}
+
+void detachInterrupt(uint8_t interruptNum)
+{
+  if (interruptNum < HOST_INTERRUPTS)
+    _isr[interruptNum] = NULL;
+}
+
+void interrupts()
+{
+}
+
+void noInterrupts()
+{
+}
+
+bool hostInterruptAttached(int pin)
+{
+  int interruptNum = digitalPinToInterrupt(pin);
+  return ((interruptNum != NOT_AN_INTERRUPT) && (_isr[interruptNum] != NULL));
+}
+
+int hostInterruptMode(int pin)
+{
+  return (hostInterruptAttached(pin) ? _isrMode[digitalPinToInterrupt(pin)] : -1);
+}
+
+bool hostFireInterrupt(int pin)
+{
+  if (!hostInterruptAttached(pin))
+    return (false);
+  _isr[digitalPinToInterrupt(pin)]();
+  return (true);
+}
+
+void hostResetInterrupts()
+{
+  for (uint8_t i = 0; i < HOST_INTERRUPTS; i++)
+    _isr[i] = NULL;
+}
@@ -0,0 +1,20 @@
+/*
+  Host build of the SparkFun ACS37800 library : control of the virtual time and the simulated interrupts
+*/
+
+#ifndef ACS37800_HOST_CONTROL_H
+#define ACS37800_HOST_CONTROL_H
+
+#include <stdint.h>
+
+uint64_t hostNanos(); // The virtual time (ns)
+void hostSetMicros(uint64_t us); // Set the virtual time
+void hostAdvanceNanos(uint64_t ns); // Move the virtual time forward
+
+//Interrupts
+bool hostInterruptAttached(int pin); // True if an interrupt routine is attached to pin
+int hostInterruptMode(int pin); // The mode passed to attachInterrupt for pin
+bool hostFireInterrupt(int pin); // Call the routine attached to pin. Returns false if there is none
+void hostResetInterrupts(); // Detach everything
+
+#endif
@@ -0,0 +1,152 @@
+/*
+  Host build of the SparkFun ACS37800 library : a fake TwoWire
+*/
+
+#include "Wire.h"
+
+TwoWire Wire;
+TwoWire Wire1;
+
+TwoWire::TwoWire()
+{
+  for (uint8_t i = 0; i < 128; i++)
+    _devices[i] = NULL;
+  _clock = 100000;
+  _advanceTime = true;
+  _failCount = 0;
+  _failError = 2;
+  _txAddress = 0;
+  _txLength = 0;
+  _rxLength = 0;
+  _rxIndex = 0;
+  resetStatistics();
+}
+
+void TwoWire::setClock(uint32_t clock)
+{
+  if (clock > 0)
+    _clock = clock;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+  _txAddress = address & 0x7F;
+  _txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+  if (_txLength >= BUFFER_SIZE)
+    return (0);
+  _txBuffer[_txLength++] = data;
+  return (1);
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+  (void)sendStop;
+  _statistics.writeTransactions++;
+  _statistics.bytesWritten += _txLength;
+  busTime(_txLength);
+
+  if (_failCount > 0)
+  {
+    _failCount--;
+    _statistics.nacks++;
+    return (_failError);
+  }
+
+  HostI2CDevice *device = _devices[_txAddress];
+  if (device == NULL)
+  {
+    _statistics.nacks++;
+    return (2); // NACK on address
+  }
+
+  if (!device->i2cWrite(_txBuffer, _txLength))
+  {
+    _statistics.nacks++;
+    return (3); // NACK on data
+  }
+
+  return (0);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool sendStop)
+{
+  (void)sendStop;
+  _rxLength = 0;
+  _rxIndex = 0;
+  if (quantity > BUFFER_SIZE)
+    quantity = BUFFER_SIZE;
+
+  _statistics.readTransactions++;
+
+  HostI2CDevice *device = _devices[address & 0x7F];
+  if (_failCount > 0)
+  {
+    _failCount--;
+    device = NULL;
+  }
+
+  if (device == NULL)
+  {
+    _statistics.nacks++;
+    busTime(0);
+    return (0);
+  }
+
+  _rxLength = (uint8_t)device->i2cRead(_rxBuffer, quantity);
+  _statistics.bytesRead += _rxLength;
+  busTime(quantity); // The controller clocks all of the requested bytes
+  return (_rxLength);
+}
+
+int TwoWire::available()
+{
+  return (_rxLength - _rxIndex);
+}
+
+int TwoWire::read()
+{
+  if (_rxIndex >= _rxLength)
+    return (-1);
+  return (_rxBuffer[_rxIndex++]);
+}
+
+int TwoWire::peek()
+{
+  if (_rxIndex >= _rxLength)
+    return (-1);
+  return (_rxBuffer[_rxIndex]);
+}
+
+void TwoWire::attach(uint8_t address, HostI2CDevice *device)
+{
+  _devices[address & 0x7F] = device;
+}
+
+void TwoWire::failNext(uint8_t count, uint8_t error)
+{
+  _failCount = count;
+  _failError = error;
+}
+
+void TwoWire::setAdvanceTime(bool advance)
+{
+  _advanceTime = advance;
+}
+
+void TwoWire::resetStatistics()
+{
+  memset(&_statistics, 0, sizeof(_statistics));
+}
+
+//Start + address + bytes, 9 clocks each (8 bits + ACK), + stop
+void TwoWire::busTime(uint8_t bytes)
+{
+  uint64_t nanos = (((uint64_t)(bytes + 1) * 9) + 2) * 1000000000ULL / _clock;
+  _statistics.busNanos += nanos;
+  if (_advanceTime)
+    hostAdvanceNanos(nanos);
+}
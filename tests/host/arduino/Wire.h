@@ -0,0 +1,86 @@
+/*
+  Host build of the SparkFun ACS37800 library : a fake TwoWire
+
+  Devices (e.g. ACS37800Simulator) attach to a bus at an I2C address. A transaction to an address with no device
+  is NACKed, as on real hardware. Each transaction advances the virtual time by its duration at the bus clock
+  (setClock, 100kHz by default) and is counted, so the bus cost of each driver call can be measured.
+*/
+
+#ifndef ACS37800_HOST_WIRE_H
+#define ACS37800_HOST_WIRE_H
+
+#include "Arduino.h"
+
+//A device on the fake bus
+class HostI2CDevice
+{
+  public:
+    virtual ~HostI2CDevice() {}
+    //A write transaction: the bytes after the address. Return false to NACK
+    virtual bool i2cWrite(const uint8_t *data, size_t length) = 0;
+    //A read transaction: fill data with up to length bytes. Return the number of bytes provided
+    virtual size_t i2cRead(uint8_t *data, size_t length) = 0;
+};
+
+//Bus statistics
+typedef struct
+{
+  uint32_t writeTransactions;
+  uint32_t readTransactions;
+  uint32_t bytesWritten; // Excluding the address bytes
+  uint32_t bytesRead;
+  uint32_t nacks;
+  uint64_t busNanos; // Time spent on the bus
+} HOST_I2C_STATISTICS_t;
+
+class TwoWire : public Stream
+{
+  public:
+    TwoWire();
+
+    void begin() {}
+    void end() {}
+    void setClock(uint32_t clock);
+
+    void beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool sendStop = true); // 0 = success, 2 = NACK on address, 3 = NACK on data
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+    uint8_t requestFrom(int address, int quantity) { return (requestFrom((uint8_t)address, (uint8_t)quantity)); }
+
+    size_t write(uint8_t data);
+    using Print::write;
+    int available();
+    int read();
+    int peek();
+
+    //Host control
+    void attach(uint8_t address, HostI2CDevice *device); // NULL to detach
+    void failNext(uint8_t count, uint8_t error = 2); // Fail the next count transactions with error (reads return zero bytes)
+    void setAdvanceTime(bool advance); // Set false to stop the transactions from advancing the virtual time
+    const HOST_I2C_STATISTICS_t &getStatistics() { return (_statistics); }
+    void resetStatistics();
+
+  private:
+    static const uint8_t BUFFER_SIZE = 32;
+
+    HostI2CDevice *_devices[128];
+    uint32_t _clock;
+    bool _advanceTime;
+    uint8_t _failCount;
+    uint8_t _failError;
+    HOST_I2C_STATISTICS_t _statistics;
+
+    uint8_t _txAddress;
+    uint8_t _txBuffer[BUFFER_SIZE];
+    uint8_t _txLength;
+    uint8_t _rxBuffer[BUFFER_SIZE];
+    uint8_t _rxLength;
+    uint8_t _rxIndex;
+
+    void busTime(uint8_t bytes); // Account for a transaction of bytes (plus the address byte)
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif
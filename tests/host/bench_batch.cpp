@@ -0,0 +1,138 @@
+/*
+  Host build of the SparkFun ACS37800 library : batch decoding throughput versus the per-sample path
+  Decodes a block of raw 0x2A / 0x2C words, as a gateway would:
+    per sample   : a (not inlined) function call per sample, using the same logic as readInstantaneous. The baseline
+    batch x1     : decodeInstantaneous with count = 1 for each sample
+    batch        : unpackInstantaneous + decodeInstantaneous on the whole block
+    inline loop  : the readInstantaneous logic written out as a loop in the caller, which the compiler can vectorize too
+    int          : applyFixedScale per sample, against unpackInstantaneous + decodeInstantaneousInt on the whole block
+  Prints Msamples/s for each, and the speedup over the per-sample path. Build with -O2 or -O3 (the default here) to let the compiler vectorize the batch kernels.
+  Run with --quick for a short smoke test (as ctest does).
+*/
+
+#include "test_harness.h"
+
+static const uint32_t BLOCK = 4096; // Samples per block : fits in L1 / L2
+
+static uint32_t reg2A[BLOCK];
+static uint32_t reg2C[BLOCK];
+static int16_t vCodes[BLOCK], iCodes[BLOCK], pCodes[BLOCK];
+static float volts[BLOCK], amps[BLOCK], watts[BLOCK];
+static int32_t milliVolts[BLOCK], milliAmps[BLOCK], milliWatts[BLOCK];
+static ACS37800_CALIBRATION_t calibration;
+static uint32_t blocks = 4000;
+
+//One sample, as readInstantaneous decodes it
+static void __attribute__((noinline)) decodeSample(uint32_t reg2AData, uint32_t reg2CData, float *v, float *i, float *p)
+{
+  *v = (float)ACS37800_FIELD_VCODES::extract(reg2AData) * calibration.voltsPerCodeInst;
+  *i = (float)ACS37800_FIELD_ICODES::extract(reg2AData) * calibration.ampsPerCodeInst;
+  *p = (float)ACS37800_FIELD_PINSTANT::extract(reg2CData) * calibration.wattsPerCode;
+}
+
+static void perSampleFloat()
+{
+  for (uint32_t s = 0; s < BLOCK; s++)
+    decodeSample(reg2A[s], reg2C[s], &volts[s], &amps[s], &watts[s]);
+}
+
+static void inlineFloat()
+{
+  for (uint32_t s = 0; s < BLOCK; s++)
+  {
+    volts[s] = (float)ACS37800_FIELD_VCODES::extract(reg2A[s]) * calibration.voltsPerCodeInst;
+    amps[s] = (float)ACS37800_FIELD_ICODES::extract(reg2A[s]) * calibration.ampsPerCodeInst;
+    watts[s] = (float)ACS37800_FIELD_PINSTANT::extract(reg2C[s]) * calibration.wattsPerCode;
+  }
+}
+
+static void batchPerSample()
+{
+  ACS37800::unpackInstantaneous(reg2A, reg2C, BLOCK, vCodes, iCodes, pCodes);
+  for (uint32_t s = 0; s < BLOCK; s++)
+    ACS37800::decodeInstantaneous(&vCodes[s], &iCodes[s], &pCodes[s], 1, calibration, &volts[s], &amps[s], &watts[s]);
+}
+
+static void batchFloat()
+{
+  ACS37800::unpackInstantaneous(reg2A, reg2C, BLOCK, vCodes, iCodes, pCodes);
+  ACS37800::decodeInstantaneous(vCodes, iCodes, pCodes, BLOCK, calibration, volts, amps, watts);
+}
+
+static void scalarFixed()
+{
+  for (uint32_t s = 0; s < BLOCK; s++)
+  {
+    milliVolts[s] = ACS37800::applyFixedScale(ACS37800_FIELD_VCODES::extract(reg2A[s]), calibration.milliVoltsInst);
+    milliAmps[s] = ACS37800::applyFixedScale(ACS37800_FIELD_ICODES::extract(reg2A[s]), calibration.milliAmpsInst);
+    milliWatts[s] = ACS37800::applyFixedScale(ACS37800_FIELD_PINSTANT::extract(reg2C[s]), calibration.milliWatts);
+  }
+}
+
+static void batchFixed()
+{
+  ACS37800::unpackInstantaneous(reg2A, reg2C, BLOCK, vCodes, iCodes, pCodes);
+  ACS37800::decodeInstantaneousInt(vCodes, iCodes, pCodes, BLOCK, calibration, milliVolts, milliAmps, milliWatts);
+}
+
+//Returns Msamples/s : the best of five runs
+static double throughput(void (*function)())
+{
+  double best = 0;
+  for (uint8_t run = 0; run < 5; run++)
+  {
+    uint64_t start = wallNanos();
+    for (uint32_t b = 0; b < blocks; b++)
+    {
+      function();
+      reg2A[b % BLOCK] ^= 1; // Stop the compiler hoisting the work out of the loop
+    }
+    double rate = ((double)blocks * BLOCK * 1000.0) / (double)(wallNanos() - start);
+    if (rate > best)
+      best = rate;
+  }
+  return (best);
+}
+
+int main(int argc, char **argv)
+{
+  if (quickRun(argc, argv))
+    blocks = 10;
+
+  ACS37800 sensor;
+  sensor.getCalibration(&calibration);
+  for (uint32_t s = 0; s < BLOCK; s++)
+  {
+    reg2A[s] = (s * 2654435761u);
+    reg2C[s] = (s * 40503u);
+  }
+
+  double scalar = throughput(perSampleFloat);
+  double perSample = throughput(batchPerSample);
+  double batch = throughput(batchFloat);
+  double inlined = throughput(inlineFloat);
+  double scalarInt = throughput(scalarFixed);
+  double batchInt = throughput(batchFixed);
+
+  printf("%-34s %12s %8s\n", "path", "Msamples/s", "speedup");
+  printf("%-34s %12.1f %8.2f\n", "per sample (readInstantaneous)", scalar, 1.0);
+  printf("%-34s %12.1f %8.2f\n", "decodeInstantaneous x1", perSample, perSample / scalar);
+  printf("%-34s %12.1f %8.2f\n", "decodeInstantaneous (batch)", batch, batch / scalar);
+  printf("%-34s %12.1f %8.2f\n", "inline loop", inlined, inlined / scalar);
+  printf("%-34s %12.1f %8.2f\n", "applyFixedScale per sample", scalarInt, 1.0);
+  printf("%-34s %12.1f %8.2f\n", "decodeInstantaneousInt (batch)", batchInt, batchInt / scalarInt);
+
+  //The results must agree
+  perSampleFloat();
+  float scalarVolts = volts[BLOCK - 1];
+  batchFloat();
+  CHECK(scalarVolts == volts[BLOCK - 1]);
+  inlineFloat();
+  CHECK(scalarVolts == volts[BLOCK - 1]);
+  scalarFixed();
+  int32_t scalarMilliWatts = milliWatts[BLOCK - 1];
+  batchFixed();
+  CHECK_EQUAL(scalarMilliWatts, milliWatts[BLOCK - 1]);
+
+  return (TEST_RESULT());
+}
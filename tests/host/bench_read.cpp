@@ -0,0 +1,120 @@
+/*
+  Host build of the SparkFun ACS37800 library : the cost of each read function, against the simulated ACS37800
+  The host version of Example8_Benchmark. For each function it prints:
+    bus bytes : bytes on the I2C bus per call, including the address bytes
+    bus us    : bus time per call at 400kHz (start, address, data and stop, 9 clocks per byte)
+    host ns   : host time per call, including the fake bus (best of five runs)
+    decode ns : host ns minus the host time for the same register reads alone. A few ns on a PC: close to the noise
+    calls/sec : 1 / (bus time + decode time) - the bus-limited rate with this host's decode time
+  Run with --quick for a short smoke test (as ctest does).
+*/
+
+#include "test_harness.h"
+
+static ACS37800 sensor;
+static unsigned long iterations = 200000;
+
+//Storage for the results - global so the compiler cannot optimize the calls away
+static float f1, f2, f3;
+static bool b1, b2;
+static int32_t i1, i2, i3;
+static int16_t q1;
+static uint32_t reg[3];
+static ACS37800_REGISTER_2D_t errorFlags;
+static ACS37800_MEASUREMENTS_t measurements;
+static ACS37800_RAW_SNAPSHOT_t snapshot;
+static ACS37800_DECODED_SNAPSHOT_t decoded;
+static ACS37800_CALIBRATION_t calibration;
+
+//The functions under test
+static void callReadRMS() { sensor.readRMS(&f1, &f2); }
+static void callReadPowerActiveReactive() { sensor.readPowerActiveReactive(&f1, &f2); }
+static void callReadPowerFactor() { sensor.readPowerFactor(&f1, &f2, &b1, &b2); }
+static void callReadInstantaneous() { sensor.readInstantaneous(&f1, &f2, &f3); }
+static void callReadErrorFlags() { sensor.readErrorFlags(&errorFlags); }
+static void callReadMeasurements() { sensor.readMeasurements(&measurements); }
+static void callReadRMSInt() { sensor.readRMSInt(&i1, &i2); }
+static void callReadPowerActiveReactiveInt() { sensor.readPowerActiveReactiveInt(&i1, &i2); }
+static void callReadPowerFactorInt() { sensor.readPowerFactorInt(&i1, &q1, &b1, &b2); }
+static void callReadInstantaneousInt() { sensor.readInstantaneousInt(&i1, &i2, &i3); }
+static void callReadRaw() { sensor.readRaw(&snapshot); }
+static void callDecode() { ACS37800::decode(snapshot, calibration, &decoded); }
+
+//The bus-only equivalents
+static void busNone() { }
+static void bus20() { sensor.readRegister(&reg[0], ACS37800_REGISTER_VOLATILE_20); }
+static void bus21() { sensor.readRegister(&reg[0], ACS37800_REGISTER_VOLATILE_21); }
+static void bus22() { sensor.readRegister(&reg[0], ACS37800_REGISTER_VOLATILE_22); }
+static void bus2D() { sensor.readRegister(&reg[0], ACS37800_REGISTER_VOLATILE_2D); }
+static void bus2A2C() { sensor.readRegister(&reg[0], ACS37800_REGISTER_VOLATILE_2A); sensor.readRegister(&reg[1], ACS37800_REGISTER_VOLATILE_2C); }
+static void bus20to22() { sensor.readRegisters(reg, ACS37800_REGISTER_VOLATILE_20, 3); }
+static void busRaw() { bus20to22(); bus2A2C(); }
+
+//Return the host time per call (ns) : the best average of five runs
+static double timeCall(void (*function)())
+{
+  double best = 1e30;
+  for (uint8_t run = 0; run < 5; run++)
+  {
+    uint64_t start = wallNanos();
+    for (unsigned long i = 0; i < iterations; i++)
+      function();
+    double average = (double)(wallNanos() - start) / iterations;
+    if (average < best)
+      best = average;
+  }
+  return (best);
+}
+
+static void benchmark(const char *name, void (*function)(), void (*busOnly)(), uint8_t expectedRegisters)
+{
+  Wire.resetStatistics();
+  function();
+  HOST_I2C_STATISTICS_t statistics = Wire.getStatistics();
+  uint32_t transactions = statistics.writeTransactions + statistics.readTransactions;
+  uint32_t busBytes = transactions + statistics.bytesWritten + statistics.bytesRead; // Address bytes + data
+  double busMicros = (double)statistics.busNanos / 1000.0;
+  CHECK_EQUAL(expectedRegisters * 2, transactions); // One address write and one read per register
+
+  double totalNs = timeCall(function);
+  double busNs = timeCall(busOnly);
+  double decodeNs = (totalNs > busNs) ? totalNs - busNs : 0;
+  double callsPerSecond = 1e9 / ((busMicros * 1000.0) + decodeNs);
+
+  printf("%-30s %12.0f %10u %8.1f %10.1f %10.1f\n", name, callsPerSecond, busBytes, busMicros, totalNs, decodeNs);
+}
+
+int main(int argc, char **argv)
+{
+  if (quickRun(argc, argv))
+    iterations = 1000;
+
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  Wire.setClock(400000);
+  Wire.setAdvanceTime(false);
+  CHECK(sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire));
+  sensor.getCalibration(&calibration);
+  sim.setRMS(20000, -1234);
+  sim.setPower(-2345, 3456);
+  sim.setPowerFactor(4567, -300, true, false);
+  sim.setInstantaneous(-5678, 6789, -7890);
+  sensor.readRaw(&snapshot); // Something to decode
+
+  printf("%-30s %12s %10s %8s %10s %10s\n", "function", "calls/sec", "bus bytes", "bus us", "host ns", "decode ns");
+  benchmark("readRMS", callReadRMS, bus20, 1);
+  benchmark("readPowerActiveReactive", callReadPowerActiveReactive, bus21, 1);
+  benchmark("readPowerFactor", callReadPowerFactor, bus22, 1);
+  benchmark("readInstantaneous", callReadInstantaneous, bus2A2C, 2);
+  benchmark("readErrorFlags", callReadErrorFlags, bus2D, 1);
+  benchmark("readMeasurements", callReadMeasurements, bus20to22, 3);
+  benchmark("readRMSInt", callReadRMSInt, bus20, 1);
+  benchmark("readPowerActiveReactiveInt", callReadPowerActiveReactiveInt, bus21, 1);
+  benchmark("readPowerFactorInt", callReadPowerFactorInt, bus22, 1);
+  benchmark("readInstantaneousInt", callReadInstantaneousInt, bus2A2C, 2);
+  benchmark("readRaw", callReadRaw, busRaw, 5);
+  benchmark("decode", callDecode, busNone, 0);
+
+  sim.detach();
+  return (TEST_RESULT());
+}
@@ -0,0 +1,206 @@
+/*
+  Host build of the SparkFun ACS37800 library : a simulated ACS37800
+*/
+
+#include "ACS37800Simulator.h"
+
+ACS37800Simulator::ACS37800Simulator(uint8_t address)
+{
+  _address = address & 0x7F;
+  memset(_registers, 0, sizeof(_registers));
+  memset(_pending, 0, sizeof(_pending));
+  memset(_pendingValue, 0, sizeof(_pendingValue));
+  memset(_pendingUntil, 0, sizeof(_pendingUntil));
+  resetCounts();
+
+  _registers[ACS37800_REGISTER_EEPROM_0B] = ACS37800_FIELD_CRS_SNS::insert(0, 2); // Typical factory settings
+  _registers[ACS37800_REGISTER_EEPROM_0F] = ACS37800_FIELD_N::insert(0, 32);
+  _registers[0x25] = ACS37800_FIELD_NUMPTSOUT::insert(0, 32); // numptsout : 1ms at 32kHz
+  powerCycle();
+}
+
+void ACS37800Simulator::attach(TwoWire &wire)
+{
+  detach();
+  _wire = &wire;
+  _wire->attach(_address, this);
+}
+
+void ACS37800Simulator::detach()
+{
+  if (_wire != NULL)
+    _wire->attach(_address, NULL);
+}
+
+void ACS37800Simulator::powerCycle()
+{
+  completeWrites();
+  for (uint8_t i = 0; i < 5; i++)
+  {
+    _registers[ACS37800_REGISTER_SHADOW_1B + i] = _registers[ACS37800_REGISTER_EEPROM_0B + i] & ACS37800_REGISTER_DATA_MASK;
+    _pending[ACS37800_REGISTER_SHADOW_1B + i] = false;
+  }
+  _unlocked = false;
+
+  uint32_t eeprom0F = _registers[ACS37800_REGISTER_EEPROM_0F];
+  if (ACS37800_FIELD_I2C_DIS_SLV_ADDR::extract(eeprom0F) == 1)
+  {
+    TwoWire *wire = _wire;
+    detach();
+    _address = (uint8_t)ACS37800_FIELD_I2C_SLV_ADDR::extract(eeprom0F);
+    if (wire != NULL)
+      attach(*wire);
+  }
+}
+
+uint32_t ACS37800Simulator::getRegister(uint8_t address)
+{
+  completeWrites();
+  return (_registers[address & 0x3F]);
+}
+
+void ACS37800Simulator::setRegister(uint8_t address, uint32_t value)
+{
+  _registers[address & 0x3F] = value;
+  _pending[address & 0x3F] = false;
+}
+
+void ACS37800Simulator::setRMS(uint16_t vrms, int16_t irms)
+{
+  setRegister(ACS37800_REGISTER_VOLATILE_20, ACS37800_FIELD_IRMS::insert(ACS37800_FIELD_VRMS::insert(0, vrms), irms));
+}
+
+void ACS37800Simulator::setPower(int16_t pactive, uint16_t pimag)
+{
+  setRegister(ACS37800_REGISTER_VOLATILE_21, ACS37800_FIELD_PIMAG::insert(ACS37800_FIELD_PACTIVE::insert(0, pactive), pimag));
+}
+
+void ACS37800Simulator::setPowerFactor(uint16_t papparent, int16_t pfactor, bool posangle, bool pospf)
+{
+  uint32_t value = ACS37800_FIELD_PAPPARENT::insert(0, papparent);
+  value = ACS37800_FIELD_PFACTOR::insert(value, pfactor);
+  value = ACS37800_FIELD_POSANGLE::insert(value, posangle ? 1 : 0);
+  value = ACS37800_FIELD_POSPF::insert(value, pospf ? 1 : 0);
+  setRegister(ACS37800_REGISTER_VOLATILE_22, value);
+}
+
+void ACS37800Simulator::setInstantaneous(int16_t vcodes, int16_t icodes, int16_t pinstant)
+{
+  setRegister(ACS37800_REGISTER_VOLATILE_2A, ACS37800_FIELD_ICODES::insert(ACS37800_FIELD_VCODES::insert(0, vcodes), icodes));
+  setRegister(ACS37800_REGISTER_VOLATILE_2C, ACS37800_FIELD_PINSTANT::insert(0, pinstant));
+}
+
+void ACS37800Simulator::setWriteLatency(unsigned long shadowMicros, unsigned long eepromMicros)
+{
+  _shadowLatency = shadowMicros;
+  _eepromLatency = eepromMicros;
+}
+
+void ACS37800Simulator::setECCStatus(uint8_t ecc)
+{
+  _ecc = ecc & 0x3F;
+}
+
+void ACS37800Simulator::setSampleHandler(ACS37800_SIM_SAMPLE_HANDLER handler, void *context)
+{
+  _sampleHandler = handler;
+  _sampleContext = context;
+}
+
+void ACS37800Simulator::resetCounts()
+{
+  memset(_reads, 0, sizeof(_reads));
+  memset(_writes, 0, sizeof(_writes));
+  _lockedWrites = 0;
+}
+
+//A write transaction : the register address, optionally followed by 4 data bytes (LSB first)
+bool ACS37800Simulator::i2cWrite(const uint8_t *data, size_t length)
+{
+  if (length == 0)
+    return (true); // Address probe
+  if ((length != 1) && (length != 5))
+    return (false);
+
+  _pointer = data[0] & 0x3F;
+  if (length == 5)
+  {
+    uint32_t value = (uint32_t)data[1] | ((uint32_t)data[2] << 8) | ((uint32_t)data[3] << 16) | ((uint32_t)data[4] << 24);
+    _writes[_pointer]++;
+    writeRegister(_pointer, value);
+  }
+  return (true);
+}
+
+//A read transaction : the register selected by the last write, LSB first
+size_t ACS37800Simulator::i2cRead(uint8_t *data, size_t length)
+{
+  _reads[_pointer]++;
+  uint32_t value = readRegister(_pointer);
+  size_t count = (length < 4) ? length : 4;
+  for (size_t i = 0; i < count; i++)
+    data[i] = (value >> (8 * i)) & 0xFF;
+  return (count);
+}
+
+void ACS37800Simulator::completeWrites()
+{
+  uint64_t now = hostNanos();
+  for (uint8_t address = 0; address < 0x40; address++)
+  {
+    if (_pending[address] && (now >= _pendingUntil[address]))
+    {
+      _registers[address] = _pendingValue[address];
+      _pending[address] = false;
+    }
+  }
+}
+
+void ACS37800Simulator::writeRegister(uint8_t address, uint32_t value)
+{
+  if (address == ACS37800_REGISTER_VOLATILE_2F)
+  {
+    _unlocked = (value == ACS37800_CUSTOMER_ACCESS_CODE);
+    return;
+  }
+
+  if (address == ACS37800_REGISTER_VOLATILE_2D)
+  {
+    if (ACS37800_FIELD_FAULTLATCHED::extract(value) == 1) // Write 1 to clear
+      _registers[address] = ACS37800_FIELD_FAULTLATCHED::insert(_registers[address], 0);
+    return;
+  }
+
+  if (!isEEPROM(address) && !isShadow(address))
+    return; // Read-only or unused
+
+  if (!_unlocked)
+  {
+    _lockedWrites++;
+    return;
+  }
+
+  completeWrites();
+  _pendingValue[address] = value & ACS37800_REGISTER_DATA_MASK;
+  if (isEEPROM(address))
+    _pendingValue[address] |= (uint32_t)_ecc << 26;
+  _pendingUntil[address] = hostNanos() + (uint64_t)(isEEPROM(address) ? _eepromLatency : _shadowLatency) * 1000;
+  _pending[address] = true;
+}
+
+uint32_t ACS37800Simulator::readRegister(uint8_t address)
+{
+  completeWrites();
+
+  if (address == ACS37800_REGISTER_VOLATILE_30)
+    return (_unlocked ? 1 : 0);
+  if (address == ACS37800_REGISTER_VOLATILE_2F)
+    return (0);
+  if (_pending[address])
+    return (0); // Still being written
+
+  if ((_sampleHandler != NULL) && (address >= ACS37800_REGISTER_VOLATILE_20) && (address <= ACS37800_REGISTER_VOLATILE_2D))
+    _sampleHandler(*this, micros(), _sampleContext);
+
+  return (_registers[address]);
+}
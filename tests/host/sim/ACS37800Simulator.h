@@ -0,0 +1,87 @@
+/*
+  Host build of the SparkFun ACS37800 library : a simulated ACS37800
+
+  Implements the register map behind the fake TwoWire:
+    0x0B - 0x0F : EEPROM. Loaded into the shadow registers at power up. Bits 26-31 read back as the ECC status
+    0x1B - 0x1F : shadow registers
+    0x20 - 0x2D : volatile measurement registers. Set by the test (setRegister), or on every read by a sample handler
+    0x2F        : customer access code. Writing ACS37800_CUSTOMER_ACCESS_CODE unlocks the EEPROM and shadow registers,
+                  writing anything else locks them again. Writes to them while locked are ignored
+    0x30        : bit 0 is set while unlocked
+  EEPROM and shadow writes take time: until the write latency has passed, the register reads as zero.
+  The device answers at its I2C address. Writing i2c_slv_addr to EEPROM changes it at the next powerCycle,
+  if i2c_dis_slv_addr is set.
+*/
+
+#ifndef ACS37800_SIMULATOR_H
+#define ACS37800_SIMULATOR_H
+
+#include "SparkFun_ACS37800_Arduino_Library.h"
+
+class ACS37800Simulator;
+
+//Called before each register read, so the test can update the volatile registers from the virtual time
+typedef void (*ACS37800_SIM_SAMPLE_HANDLER)(ACS37800Simulator &simulator, unsigned long microseconds, void *context);
+
+class ACS37800Simulator : public HostI2CDevice
+{
+  public:
+
+    ACS37800Simulator(uint8_t address = ACS37800_DEFAULT_I2C_ADDRESS);
+
+    void attach(TwoWire &wire); // Connect to wire at the current address
+    void detach();
+    void powerCycle(); // Reload the shadow registers from EEPROM, lock, and apply the EEPROM I2C address
+    uint8_t getAddress() { return (_address); }
+
+    //Direct access to the registers, bypassing the access code and the write latency
+    uint32_t getRegister(uint8_t address);
+    void setRegister(uint8_t address, uint32_t value);
+
+    //Helpers for the volatile registers. The codes are the raw register fields
+    void setRMS(uint16_t vrms, int16_t irms);
+    void setPower(int16_t pactive, uint16_t pimag);
+    void setPowerFactor(uint16_t papparent, int16_t pfactor, bool posangle, bool pospf);
+    void setInstantaneous(int16_t vcodes, int16_t icodes, int16_t pinstant);
+
+    void setWriteLatency(unsigned long shadowMicros, unsigned long eepromMicros); // Defaults: 2ms and 20ms
+    void setECCStatus(uint8_t ecc); // The ECC status (0 - 63) reported by the EEPROM registers. 0 = no error
+    void setSampleHandler(ACS37800_SIM_SAMPLE_HANDLER handler, void *context = NULL);
+
+    bool isUnlocked() { return (_unlocked); }
+    uint32_t getReads(uint8_t address) { return (_reads[address & 0x3F]); }
+    uint32_t getWrites(uint8_t address) { return (_writes[address & 0x3F]); }
+    uint32_t getLockedWrites() { return (_lockedWrites); } // Writes ignored because the device was locked
+    void resetCounts();
+
+    //HostI2CDevice
+    bool i2cWrite(const uint8_t *data, size_t length);
+    size_t i2cRead(uint8_t *data, size_t length);
+
+  private:
+
+    uint8_t _address;
+    TwoWire *_wire = NULL;
+    uint32_t _registers[0x40];
+    uint32_t _pendingValue[0x40]; // EEPROM / shadow writes in progress
+    uint64_t _pendingUntil[0x40]; // hostNanos() when the write completes
+    bool _pending[0x40];
+    bool _unlocked = false;
+    uint8_t _pointer = 0;
+    uint8_t _ecc = 0;
+    unsigned long _shadowLatency = 2000;
+    unsigned long _eepromLatency = 20000;
+    ACS37800_SIM_SAMPLE_HANDLER _sampleHandler = NULL;
+    void *_sampleContext = NULL;
+    uint32_t _reads[0x40];
+    uint32_t _writes[0x40];
+    uint32_t _lockedWrites = 0;
+
+    static bool isEEPROM(uint8_t address) { return ((address >= ACS37800_REGISTER_EEPROM_0B) && (address <= ACS37800_REGISTER_EEPROM_0F)); }
+    static bool isShadow(uint8_t address) { return ((address >= ACS37800_REGISTER_SHADOW_1B) && (address <= ACS37800_REGISTER_SHADOW_1F)); }
+    void completeWrites(); // Complete any writes whose latency has passed
+    void writeRegister(uint8_t address, uint32_t value);
+    uint32_t readRegister(uint8_t address);
+};
+
+#endif
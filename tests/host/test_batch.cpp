@@ -0,0 +1,121 @@
+/*
+  Host build of the SparkFun ACS37800 library : batch decoding matches the per-sample path
+  decodeInstantaneousInt must be bit-identical to applyFixedScale, and decodeInstantaneous to readInstantaneous,
+  for every 16-bit code
+*/
+
+#include "test_harness.h"
+
+static const uint32_t CODES = 65536;
+
+static uint32_t reg2A[CODES];
+static uint32_t reg2C[CODES];
+static int16_t vCodes[CODES], iCodes[CODES], pCodes[CODES];
+static float volts[CODES], amps[CODES], watts[CODES];
+static int32_t milliVolts[CODES], milliAmps[CODES], milliWatts[CODES];
+
+//Every code on every channel. icodes runs backwards, so v and i differ
+static void fillRegisters()
+{
+  for (uint32_t code = 0; code < CODES; code++)
+  {
+    reg2A[code] = ACS37800_FIELD_ICODES::insert(ACS37800_FIELD_VCODES::insert(0, (int16_t)code), (int16_t)(0xFFFF - code));
+    reg2C[code] = ACS37800_FIELD_PINSTANT::insert(0, (int16_t)code);
+  }
+}
+
+static void testUnpack()
+{
+  fillRegisters();
+  ACS37800::unpackInstantaneous(reg2A, reg2C, CODES, vCodes, iCodes, pCodes);
+  uint32_t mismatches = 0;
+  for (uint32_t code = 0; code < CODES; code++)
+  {
+    if ((vCodes[code] != ACS37800_FIELD_VCODES::extract(reg2A[code])) || (iCodes[code] != ACS37800_FIELD_ICODES::extract(reg2A[code]))
+        || (pCodes[code] != ACS37800_FIELD_PINSTANT::extract(reg2C[code])))
+      mismatches++;
+  }
+  CHECK_EQUAL(0, mismatches);
+
+  //NULL skips a channel
+  memset(pCodes, 0, sizeof(pCodes));
+  ACS37800::unpackInstantaneous(reg2A, NULL, CODES, vCodes, iCodes, pCodes);
+  CHECK_EQUAL(0, pCodes[CODES - 1]);
+}
+
+static void checkFixed(const ACS37800_CALIBRATION_t &calibration)
+{
+  ACS37800::decodeInstantaneousInt(vCodes, iCodes, pCodes, CODES, calibration, milliVolts, milliAmps, milliWatts);
+  uint32_t mismatches = 0;
+  for (uint32_t code = 0; code < CODES; code++)
+  {
+    if ((milliVolts[code] != ACS37800::applyFixedScale(vCodes[code], calibration.milliVoltsInst))
+        || (milliAmps[code] != ACS37800::applyFixedScale(iCodes[code], calibration.milliAmpsInst))
+        || (milliWatts[code] != ACS37800::applyFixedScale(pCodes[code], calibration.milliWatts)))
+      mismatches++;
+  }
+  CHECK_EQUAL(0, mismatches);
+}
+
+//Bit-identical to applyFixedScale, for several calibrations - and with shift == 0, where the rounding term is zero
+static void testFixedMatchesScalar()
+{
+  fillRegisters();
+  ACS37800::unpackInstantaneous(reg2A, reg2C, CODES, vCodes, iCodes, pCodes);
+
+  ACS37800 sensor;
+  float ranges[] = { 30, 90, 5 };
+  for (uint8_t r = 0; r < 3; r++)
+  {
+    sensor.setCurrentRange(ranges[r]);
+    ACS37800_CALIBRATION_t calibration;
+    sensor.getCalibration(&calibration);
+    checkFixed(calibration);
+  }
+
+  ACS37800_CALIBRATION_t calibration;
+  sensor.getCalibration(&calibration);
+  calibration.milliVoltsInst.multiplier = 12345;
+  calibration.milliVoltsInst.shift = 0;
+  calibration.milliAmpsInst.multiplier = 3;
+  calibration.milliAmpsInst.shift = 1;
+  checkFixed(calibration);
+}
+
+//The float batch matches readInstantaneous, which reads and decodes one sample at a time
+static void testFloatMatchesReader()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  Wire.setAdvanceTime(false);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+  ACS37800_CALIBRATION_t calibration;
+  sensor.getCalibration(&calibration);
+
+  fillRegisters();
+  ACS37800::unpackInstantaneous(reg2A, reg2C, CODES, vCodes, iCodes, pCodes);
+  ACS37800::decodeInstantaneous(vCodes, iCodes, pCodes, CODES, calibration, volts, amps, watts);
+
+  uint32_t mismatches = 0;
+  for (uint32_t code = 0; code < CODES; code++)
+  {
+    sim.setRegister(ACS37800_REGISTER_VOLATILE_2A, reg2A[code]);
+    sim.setRegister(ACS37800_REGISTER_VOLATILE_2C, reg2C[code]);
+    float v, i, p;
+    sensor.readInstantaneous(&v, &i, &p);
+    if ((v != volts[code]) || (i != amps[code]) || (p != watts[code]))
+      mismatches++;
+  }
+  CHECK_EQUAL(0, mismatches);
+  Wire.setAdvanceTime(true);
+  sim.detach();
+}
+
+int main()
+{
+  RUN_TEST(testUnpack);
+  RUN_TEST(testFixedMatchesScalar);
+  RUN_TEST(testFloatMatchesReader);
+  return (TEST_RESULT());
+}
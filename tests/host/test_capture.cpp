@@ -0,0 +1,91 @@
+/*
+  Host build of the SparkFun ACS37800 library : captureCycles with the software zero crossing detector
+  The simulator produces a 50Hz voltage sine from the virtual time, with optional noise
+*/
+
+#include "test_harness.h"
+
+static const unsigned long PERIOD = 20000; // 50Hz (us)
+
+typedef struct
+{
+  float amplitude; // vcodes
+  int16_t noise; // Uniform noise of +/- this (vcodes)
+  uint32_t seed;
+} SINE_t;
+
+static void sineHandler(ACS37800Simulator &simulator, unsigned long microseconds, void *context)
+{
+  SINE_t *sine = (SINE_t *)context;
+  float v = sine->amplitude * sinf(2.0f * (float)PI * (float)(microseconds % PERIOD) / (float)PERIOD);
+  int32_t noise = 0;
+  if (sine->noise > 0)
+  {
+    sine->seed = sine->seed * 1664525 + 1013904223;
+    noise = (int32_t)((sine->seed >> 16) % (uint32_t)(2 * sine->noise + 1)) - sine->noise;
+  }
+  simulator.setInstantaneous((int16_t)(v + (float)noise), 0, 0);
+}
+
+static ACS37800_WAVEFORM_SAMPLE_t storage[32768];
+
+//Capture cycles and check that the samples span that many periods
+//Noise moves each detected crossing by up to noise / slope at the crossing, so the tolerance grows with it
+static void checkCapture(SINE_t &sine, uint8_t cycles)
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  sim.setSampleHandler(sineHandler, &sine);
+  Wire.setClock(400000);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+  hostSetMicros(1000000 + PERIOD / 3); // Start part way through a cycle
+
+  ACS37800WaveformBuffer buffer(storage, sizeof(storage) / sizeof(storage[0]));
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.captureCycles(buffer, cycles));
+
+  ACS37800_WAVEFORM_SAMPLE_t first, last;
+  CHECK(buffer.peek(0, &first));
+  CHECK(buffer.peek(buffer.available() - 1, &last));
+  unsigned long interval = (last.timestamp - first.timestamp) / (buffer.available() - 1);
+  long span = (long)(last.timestamp - first.timestamp + interval);
+  long jitter = (long)((float)sine.noise * (float)PERIOD / (2.0f * (float)PI * sine.amplitude));
+  long tolerance = (long)interval + 2 * jitter;
+  long offset = (long)((first.timestamp + PERIOD / 2) % PERIOD) - (long)(PERIOD / 2); // From the true rising crossing
+  CHECK((offset > -jitter - 1) && (offset <= (long)interval + jitter)); // The first sample follows a rising crossing
+  CHECK(labs(span - (long)cycles * (long)PERIOD) < tolerance);
+  printf("  %u cycles : %u samples, %lu us apart\n", cycles, buffer.available(), interval);
+
+  sim.detach();
+}
+
+static void testClean()
+{
+  SINE_t sine = { 20000.0f, 0, 1 };
+  checkCapture(sine, 1);
+  checkCapture(sine, 5);
+}
+
+//Noise larger than the hysteresis, on a small signal: several sign changes around each crossing
+static void testNoise()
+{
+  SINE_t sine = { 2000.0f, 400, 12345 };
+  checkCapture(sine, 5);
+  SINE_t quiet = { 2000.0f, 200, 54321 }; // Inside the hysteresis
+  checkCapture(quiet, 5);
+}
+
+//255 cycles must finish - the crossing count is wider than cycles
+static void testMaxCycles()
+{
+  SINE_t sine = { 20000.0f, 100, 7 };
+  checkCapture(sine, 255);
+}
+
+int main()
+{
+  RUN_TEST(testClean);
+  RUN_TEST(testNoise);
+  RUN_TEST(testMaxCycles);
+  return (TEST_RESULT());
+}
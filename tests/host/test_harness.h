@@ -0,0 +1,78 @@
+/*
+  Host build of the SparkFun ACS37800 library : a minimal test harness
+
+  Each test program calls RUN_TEST for its tests and returns TEST_RESULT() from main, which is non-zero if any CHECK failed.
+*/
+
+#ifndef ACS37800_TEST_HARNESS_H
+#define ACS37800_TEST_HARNESS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "Arduino.h"
+#include "Wire.h"
+#include "SparkFun_ACS37800_Arduino_Library.h"
+#include "ACS37800Simulator.h"
+
+static int testFailures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) \
+    { \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      testFailures++; \
+    } \
+  } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+  do { \
+    long long e_ = (long long)(expected); \
+    long long a_ = (long long)(actual); \
+    if (e_ != a_) \
+    { \
+      printf("%s:%d: CHECK_EQUAL(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #expected, #actual, e_, a_); \
+      testFailures++; \
+    } \
+  } while (0)
+
+#define RUN_TEST(test) \
+  do { \
+    int before_ = testFailures; \
+    hostSetMicros(1000000); \
+    hostResetInterrupts(); \
+    test(); \
+    printf("%s %s\n", (testFailures == before_) ? "PASS" : "FAIL", #test); \
+  } while (0)
+
+#define TEST_RESULT() ((testFailures == 0) ? 0 : 1)
+
+//Wall-clock time for the benchmarks (ns). Not the virtual time
+static inline uint64_t wallNanos()
+{
+  return ((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//Benchmarks run a short version of themselves under ctest
+static inline bool quickRun(int argc, char **argv)
+{
+  return ((argc > 1) && (strcmp(argv[1], "--quick") == 0));
+}
+
+//A Stream which records everything written to it, and returns it when read
+class MemoryStream : public Stream
+{
+  public:
+    std::vector<uint8_t> data;
+    size_t position = 0;
+
+    size_t write(uint8_t c) { data.push_back(c); return (1); }
+    using Print::write;
+    int available() { return ((int)(data.size() - position)); }
+    int read() { return ((position < data.size()) ? data[position++] : -1); }
+    int peek() { return ((position < data.size()) ? data[position] : -1); }
+};
+
+#endif
@@ -0,0 +1,149 @@
+/*
+  Host build of the SparkFun ACS37800 library : the integer-only readers match the float readers
+  Every 16-bit code (every 11-bit pfactor) is read through the simulator with both APIs, for several calibrations.
+  The integer results must be within one LSB (1 mV / mA / mW / mVAR / mVA) of the float results. The power factor must be exact.
+  Above 2^23 milli-units (e.g. 21kW full scale with a 2M / 1k divider) the float result itself is only accurate to
+  about one float ULP, so for that calibration the tolerance is one LSB plus one ULP of the float result
+*/
+
+#include "test_harness.h"
+
+static double maxError;
+static bool allowULP; // Add one float ULP to the tolerance
+
+static void compare(float units, int32_t milliUnits)
+{
+  double error = fabs(((double)units * 1000.0) - (double)milliUnits);
+  double ulp = (double)(nextafterf(fabsf(units), INFINITY) - fabsf(units)) * 1000.0; // The float resolution in milli-units
+  if (allowULP)
+    error -= ulp;
+  if (error > 1.0)
+  {
+    if (testFailures < 20)
+      printf("  float %f -> %f milli-units, integer %d\n", units, (double)units * 1000.0, milliUnits);
+    testFailures++;
+  }
+  if (error > maxError)
+    maxError = error;
+}
+
+static void sweep(ACS37800 &sensor, ACS37800Simulator &sim)
+{
+  for (uint32_t code = 0; code <= 0xFFFF; code++)
+  {
+    int16_t signedCode = (int16_t)(uint16_t)code;
+
+    sim.setRMS((uint16_t)code, signedCode);
+    float vRMS, iRMS;
+    int32_t mV, mA;
+    CHECK_EQUAL(ACS37800_SUCCESS, sensor.readRMS(&vRMS, &iRMS));
+    CHECK_EQUAL(ACS37800_SUCCESS, sensor.readRMSInt(&mV, &mA));
+    compare(vRMS, mV);
+    compare(iRMS, mA);
+
+    sim.setPower(signedCode, (uint16_t)code);
+    float pActive, pReactive;
+    int32_t mW, mVAR;
+    CHECK_EQUAL(ACS37800_SUCCESS, sensor.readPowerActiveReactive(&pActive, &pReactive));
+    CHECK_EQUAL(ACS37800_SUCCESS, sensor.readPowerActiveReactiveInt(&mW, &mVAR));
+    compare(pActive, mW);
+    compare(pReactive, mVAR);
+
+    sim.setPowerFactor((uint16_t)code, 0, false, false);
+    float pApparent, pFactor;
+    bool posangle, pospf;
+    int32_t mVA;
+    int16_t pFactorQ15;
+    CHECK_EQUAL(ACS37800_SUCCESS, sensor.readPowerFactor(&pApparent, &pFactor, &posangle, &pospf));
+    CHECK_EQUAL(ACS37800_SUCCESS, sensor.readPowerFactorInt(&mVA, &pFactorQ15, &posangle, &pospf));
+    compare(pApparent, mVA);
+
+    sim.setInstantaneous(signedCode, signedCode, signedCode);
+    float vInst, iInst, pInst;
+    int32_t mVInst, mAInst, mWInst;
+    CHECK_EQUAL(ACS37800_SUCCESS, sensor.readInstantaneous(&vInst, &iInst, &pInst));
+    CHECK_EQUAL(ACS37800_SUCCESS, sensor.readInstantaneousInt(&mVInst, &mAInst, &mWInst));
+    compare(vInst, mVInst);
+    compare(iInst, mAInst);
+    compare(pInst, mWInst);
+  }
+}
+
+static void testDefaultCalibration()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+  maxError = 0;
+  sweep(sensor, sim);
+  printf("  30A, 2M / 8.2k : max error %.3f LSB\n", maxError);
+  sim.detach();
+}
+
+static void testOtherCalibrations()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+
+  sensor.setCurrentRange(90);
+  maxError = 0;
+  sweep(sensor, sim);
+  printf("  90A, 2M / 8.2k : max error %.3f LSB\n", maxError);
+
+  sensor.setCurrentRange(30);
+  sensor.setSenseRes(1000);
+  maxError = 0;
+  allowULP = true;
+  sweep(sensor, sim);
+  allowULP = false;
+  printf("  30A, 2M / 1k : max error %.3f LSB beyond one float ULP\n", maxError);
+
+  sensor.setCurrentRange(5);
+  sensor.setDividerRes(1000000);
+  sensor.setSenseRes(4700);
+  maxError = 0;
+  sweep(sensor, sim);
+  printf("  5A, 1M / 4.7k : max error %.3f LSB\n", maxError);
+  sim.detach();
+}
+
+//pfactor : every 11-bit code. Q15 is the float value x 32768, exactly
+static void testPowerFactor()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+
+  for (int32_t code = -1024; code <= 1023; code++)
+  {
+    bool posangle = (code & 1) != 0;
+    bool pospf = (code & 2) != 0;
+    sim.setPowerFactor(0, (int16_t)code, posangle, pospf);
+    float pApparent, pFactor;
+    bool floatAngle, floatPF, intAngle, intPF;
+    int32_t mVA;
+    int16_t pFactorQ15;
+    sensor.readPowerFactor(&pApparent, &pFactor, &floatAngle, &floatPF);
+    sensor.readPowerFactorInt(&mVA, &pFactorQ15, &intAngle, &intPF);
+    CHECK_EQUAL((int32_t)(pFactor * 32768.0f), pFactorQ15);
+    CHECK_EQUAL(code * 32, pFactorQ15);
+    CHECK(intAngle == posangle);
+    CHECK(intPF == pospf);
+    CHECK(floatAngle == posangle);
+    CHECK(floatPF == pospf);
+  }
+  sim.detach();
+}
+
+int main()
+{
+  Wire.setAdvanceTime(false);
+  RUN_TEST(testDefaultCalibration);
+  RUN_TEST(testOtherCalibrations);
+  RUN_TEST(testPowerFactor);
+  return (TEST_RESULT());
+}
@@ -0,0 +1,93 @@
+/*
+  Host build of the SparkFun ACS37800 library : the event and zero crossing interrupts
+  Built twice: with an int interrupt mode (AVR style) and with PinStatus (ArduinoCore-API, ACS37800_HOST_ARDUINO_API)
+*/
+
+#include "test_harness.h"
+
+static uint8_t callbacks = 0;
+
+static void onEvent(ACS37800_REGISTER_2D_t flags, void *context)
+{
+  (void)flags;
+  (void)context;
+  callbacks++;
+}
+
+//Events on pins 2 and 3. The mode is passed through to attachInterrupt
+static void testEvents()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+  callbacks = 0;
+
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.attachEventInterrupts(2, 3, onEvent, NULL, FALLING));
+  CHECK_EQUAL(FALLING, hostInterruptMode(2));
+  CHECK_EQUAL(FALLING, hostInterruptMode(3));
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.checkEvents()); // The first call always reads 0x2D
+  CHECK_EQUAL(1, callbacks);
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.checkEvents());
+  CHECK_EQUAL(1, callbacks);
+  CHECK(hostFireInterrupt(3));
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.checkEvents());
+  CHECK_EQUAL(2, callbacks);
+
+  sensor.detachInterrupts();
+  CHECK(!hostInterruptAttached(2));
+  CHECK(!hostInterruptAttached(3));
+  sim.detach();
+}
+
+//A pin without an interrupt is rejected - and nothing is attached, or left allocated
+static void testNoInterrupt()
+{
+  ACS37800 sensors[ACS37800_MAX_EVENT_DEVICES];
+  for (uint8_t i = 0; i < ACS37800_MAX_EVENT_DEVICES; i++)
+  {
+    CHECK_EQUAL(ACS37800_ERR_INTERRUPT_UNAVAILABLE, sensors[i].attachEventInterrupts(2, 5, onEvent));
+    CHECK_EQUAL(ACS37800_ERR_INTERRUPT_UNAVAILABLE, sensors[i].attachZeroCrossingInterrupt(7));
+    CHECK_EQUAL(ACS37800_ERR_INTERRUPT_UNAVAILABLE, sensors[i].attachZeroCrossingInterrupt(-1));
+  }
+  CHECK(!hostInterruptAttached(2));
+
+  ACS37800 sensor;
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.attachZeroCrossingInterrupt(2)); // A slot is still free
+  CHECK_EQUAL(RISING, hostInterruptMode(2));
+  sensor.detachInterrupts();
+}
+
+//DIO_0 cannot be armed for both events and zero crossing, nor by two objects
+static void testPinConflicts()
+{
+  ACS37800 sensor;
+  CHECK_EQUAL(ACS37800_ERR_INTERRUPT_UNAVAILABLE, sensor.attachEventInterrupts(2, 2, onEvent));
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.attachEventInterrupts(2, -1, onEvent));
+  CHECK_EQUAL(ACS37800_ERR_INTERRUPT_UNAVAILABLE, sensor.attachZeroCrossingInterrupt(2));
+  CHECK_EQUAL(CHANGE, hostInterruptMode(2)); // Still the event routine
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.attachEventInterrupts(2, 3, onEvent)); // Re-arming the same pins is fine
+
+  ACS37800 other;
+  CHECK_EQUAL(ACS37800_ERR_INTERRUPT_UNAVAILABLE, other.attachZeroCrossingInterrupt(3));
+  CHECK_EQUAL(ACS37800_ERR_INTERRUPT_UNAVAILABLE, other.attachEventInterrupts(2, -1, onEvent));
+
+  sensor.detachInterrupts();
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.attachZeroCrossingInterrupt(2));
+  CHECK_EQUAL(ACS37800_ERR_INTERRUPT_UNAVAILABLE, sensor.attachEventInterrupts(2, 3, onEvent));
+  CHECK_EQUAL(ACS37800_SUCCESS, other.attachEventInterrupts(3, -1, onEvent));
+
+  sensor.detachInterrupts();
+  other.detachInterrupts();
+}
+
+int main()
+{
+#if defined(ARDUINO_API_VERSION)
+  printf("ArduinoCore-API : PinStatus interrupt modes\n");
+#endif
+  RUN_TEST(testEvents);
+  RUN_TEST(testNoInterrupt);
+  RUN_TEST(testPinConflicts);
+  return (TEST_RESULT());
+}
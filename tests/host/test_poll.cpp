@@ -0,0 +1,81 @@
+/*
+  Host build of the SparkFun ACS37800 library : the pollMeasurements schedule
+  The simulated chip updates 0x20 - 0x22 once per period. Bus traffic is counted with the simulator's read counts
+*/
+
+#include "test_harness.h"
+
+static const unsigned long PERIOD = 10000; // numptsout 320 at 32kHz (us)
+static const unsigned long PHASE = 3700; // The chip's updates are not aligned with anything
+
+typedef struct
+{
+  bool steady; // true : the readings never change (e.g. no load)
+} CHIP_t;
+
+static void chipHandler(ACS37800Simulator &simulator, unsigned long microseconds, void *context)
+{
+  CHIP_t *chip = (CHIP_t *)context;
+  uint16_t update = chip->steady ? 0 : (uint16_t)((microseconds - PHASE) / PERIOD);
+  simulator.setRMS(20000 + (update & 0xFF), 1000);
+}
+
+//Poll every 100us for periods. Return the number of fresh results. reads is the number of reads of 0x20
+static uint32_t poll(bool steady, uint32_t periods, uint32_t *reads)
+{
+  ACS37800Simulator sim;
+  CHIP_t chip = { steady };
+  sim.attach(Wire);
+  sim.setRegister(ACS37800_REGISTER_VOLATILE_25, 320);
+  sim.setSampleHandler(chipHandler, &chip);
+  Wire.setClock(400000);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+  sim.resetCounts();
+
+  uint32_t freshCount = 0;
+  unsigned long end = micros() + periods * PERIOD;
+  while ((long)(micros() - end) < 0)
+  {
+    ACS37800_MEASUREMENTS_t measurements;
+    bool fresh = false;
+    CHECK_EQUAL(ACS37800_SUCCESS, sensor.pollMeasurements(&measurements, &fresh));
+    if (fresh)
+      freshCount++;
+    delayMicroseconds(100);
+  }
+  CHECK_EQUAL(PERIOD, sensor.getUpdatePeriod());
+
+  *reads = sim.getReads(ACS37800_REGISTER_VOLATILE_20);
+  sim.detach();
+  return (freshCount);
+}
+
+//Changing readings: the schedule locks on, and there is about one read per update
+static void testChanging()
+{
+  uint32_t reads;
+  uint32_t freshCount = poll(false, 200, &reads);
+  printf("  changing : %u fresh, %u reads in 200 periods\n", freshCount, reads);
+  CHECK(freshCount >= 195);
+  CHECK(freshCount <= 201); // The first poll is fresh too
+  CHECK(reads < 200 + 200 / 8); // Occasional stale retries as the clocks drift
+}
+
+//Steady readings: after one retry, back off to one read per period. They are still reported every two periods
+static void testSteady()
+{
+  uint32_t reads;
+  uint32_t freshCount = poll(true, 200, &reads);
+  printf("  steady : %u fresh, %u reads in 200 periods\n", freshCount, reads);
+  CHECK(freshCount >= 60);
+  CHECK(freshCount <= 101);
+  CHECK(reads <= 200 * 3 / 2);
+}
+
+int main()
+{
+  RUN_TEST(testChanging);
+  RUN_TEST(testSteady);
+  return (TEST_RESULT());
+}
@@ -0,0 +1,229 @@
+/*
+  Host build of the SparkFun ACS37800 library : the binary record format
+  Round trip of random records, recovery from corrupted and lost bytes, the key interval, and writeRecord
+*/
+
+#include "test_harness.h"
+#include <stdlib.h>
+
+static const uint16_t RECORDS = 1000;
+
+static ACS37800_RECORD_t originals[RECORDS];
+
+static bool sameRecord(const ACS37800_RECORD_t &a, const ACS37800_RECORD_t &b)
+{
+  return ((a.deviceId == b.deviceId) && (a.contents == b.contents) && (a.timestamp == b.timestamp) && (a.reg20 == b.reg20)
+          && (a.reg21 == b.reg21) && (a.reg22 == b.reg22) && (a.reg2A == b.reg2A) && (a.reg2C == b.reg2C) && (a.reg2D == b.reg2D));
+}
+
+static uint32_t random32()
+{
+  return (((uint32_t)rand() << 16) ^ (uint32_t)rand());
+}
+
+//Random records. Only the recorded bits of each register are set, and the unselected registers are zero, as the decoder returns them
+static void makeRecords()
+{
+  srand(37800);
+  uint32_t timestamp = 0xFFFF0000; // Wraps part way through
+  for (uint16_t r = 0; r < RECORDS; r++)
+  {
+    ACS37800_RECORD_t &record = originals[r];
+    memset(&record, 0, sizeof(record));
+    record.deviceId = rand() & 0xFF;
+    record.contents = (rand() % ACS37800_RECORD_ALL) + 1;
+    timestamp += (r % 50 == 0) ? random32() >> 4 : rand() % 5000; // Mostly short deltas, some long ones
+    record.timestamp = timestamp;
+    if (record.contents & ACS37800_RECORD_RMS)
+      record.reg20 = random32();
+    if (record.contents & ACS37800_RECORD_POWER)
+      record.reg21 = random32();
+    if (record.contents & ACS37800_RECORD_POWER_FACTOR)
+      record.reg22 = random32() & 0x1FFFFFFF;
+    if (record.contents & ACS37800_RECORD_INSTANTANEOUS)
+      record.reg2A = random32();
+    if (record.contents & ACS37800_RECORD_INSTANTANEOUS_POWER)
+      record.reg2C = random32() & 0xFFFF;
+    if (record.contents & ACS37800_RECORD_ERROR_FLAGS)
+      record.reg2D = random32() & 0xFFFF;
+  }
+}
+
+//Encode all of the records into one stream. starts[r] is the offset of record r
+static std::vector<uint8_t> encodeAll(ACS37800RecordEncoder &encoder, std::vector<size_t> *starts)
+{
+  std::vector<uint8_t> stream;
+  uint8_t buffer[ACS37800_RECORD_MAX_SIZE];
+  for (uint16_t r = 0; r < RECORDS; r++)
+  {
+    size_t length = encoder.encode(originals[r], buffer);
+    CHECK(length <= ACS37800_RECORD_MAX_SIZE);
+    if (starts != NULL)
+      starts->push_back(stream.size());
+    stream.insert(stream.end(), buffer, buffer + length);
+  }
+  return (stream);
+}
+
+//Decode the stream. Every decoded record must be one of the originals, in order. Returns the number decoded
+static uint16_t decodeAll(const std::vector<uint8_t> &stream, ACS37800RecordDecoder &decoder, std::vector<uint16_t> *indexes)
+{
+  uint16_t next = 0;
+  uint16_t decoded = 0;
+  ACS37800_RECORD_t record;
+  for (size_t i = 0; i < stream.size(); i++)
+  {
+    if (!decoder.decode(stream[i], &record))
+      continue;
+    decoded++;
+    while ((next < RECORDS) && !sameRecord(originals[next], record))
+      next++;
+    CHECK(next < RECORDS); // Not a record which was encoded - or out of order
+    if (indexes != NULL)
+      indexes->push_back(next);
+    next++;
+  }
+  return (decoded);
+}
+
+static void testRoundTrip()
+{
+  makeRecords();
+  ACS37800RecordEncoder encoder(16);
+  std::vector<uint8_t> stream = encodeAll(encoder, NULL);
+  ACS37800RecordDecoder decoder;
+  std::vector<uint16_t> indexes;
+  CHECK_EQUAL(RECORDS, decodeAll(stream, decoder, &indexes));
+  CHECK_EQUAL(0, decoder.getCRCErrors());
+  CHECK_EQUAL(0, decoder.getUnsynced());
+  printf("  %u records in %u bytes\n", RECORDS, (unsigned)stream.size());
+}
+
+//Damage record damaged. It is lost. The delta records after it are discarded until the next absolute record
+static void checkRecovery(const std::vector<uint8_t> &stream, uint16_t damaged, uint16_t keyInterval, bool expectCRCError)
+{
+  ACS37800RecordDecoder decoder;
+  std::vector<uint16_t> indexes;
+  decodeAll(stream, decoder, &indexes);
+
+  uint16_t nextKey = ((damaged / keyInterval) + 1) * keyInterval;
+  std::vector<uint16_t> expected;
+  for (uint16_t r = 0; r < RECORDS; r++)
+    if ((r < damaged) || (r >= nextKey))
+      expected.push_back(r);
+  CHECK(indexes == expected);
+  if (expectCRCError)
+    CHECK(decoder.getCRCErrors() >= 1);
+  CHECK(decoder.getUnsynced() <= (uint32_t)(nextKey - damaged));
+}
+
+static void testCorruption()
+{
+  makeRecords();
+  const uint16_t keyInterval = 16;
+  ACS37800RecordEncoder encoder(keyInterval);
+  std::vector<size_t> starts;
+  std::vector<uint8_t> clean = encodeAll(encoder, &starts);
+
+  srand(1);
+  for (uint16_t trial = 0; trial < 200; trial++)
+  {
+    uint16_t damaged = 1 + (rand() % (RECORDS - 2));
+    size_t length = starts[damaged + 1] - starts[damaged];
+    size_t offset = starts[damaged] + 2 + (rand() % (length - 2)); // After the sync bytes
+
+    std::vector<uint8_t> flipped = clean;
+    flipped[offset] ^= (uint8_t)(1 << (rand() % 8));
+    checkRecovery(flipped, damaged, keyInterval, true);
+
+    std::vector<uint8_t> deleted = clean;
+    deleted.erase(deleted.begin() + offset);
+    checkRecovery(deleted, damaged, keyInterval, false);
+  }
+
+  //Stray bytes between records are lost data too
+  std::vector<uint8_t> stray = clean;
+  stray.insert(stray.begin() + starts[500], 0x55);
+  checkRecovery(stray, 500, keyInterval, false);
+}
+
+//keyInterval 0 : only the first record has an absolute timestamp - even after 65536 records
+static void testKeyInterval()
+{
+  ACS37800RecordEncoder encoder(0);
+  ACS37800_RECORD_t record;
+  memset(&record, 0, sizeof(record));
+  record.contents = ACS37800_RECORD_RMS;
+  uint8_t buffer[ACS37800_RECORD_MAX_SIZE];
+  uint32_t absolute = 0;
+  for (uint32_t r = 0; r < 70000; r++)
+  {
+    record.timestamp = r * 1000;
+    encoder.encode(record, buffer);
+    if (buffer[3] & ACS37800_RECORD_ABSOLUTE)
+      absolute++;
+  }
+  CHECK_EQUAL(1, absolute);
+
+  encoder.reset();
+  encoder.encode(record, buffer);
+  CHECK(buffer[3] & ACS37800_RECORD_ABSOLUTE);
+
+  ACS37800RecordEncoder keyed(64);
+  absolute = 0;
+  for (uint32_t r = 0; r < 640; r++)
+  {
+    keyed.encode(record, buffer);
+    if (buffer[3] & ACS37800_RECORD_ABSOLUTE)
+      absolute++;
+  }
+  CHECK_EQUAL(10, absolute);
+}
+
+//writeRecord reads the registers from the device and writes a record which decodes to them
+static void testWriteRecord()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+  sim.setRMS(12345, -2345);
+  sim.setPower(-3456, 4567);
+  sim.setPowerFactor(5678, -700, true, true);
+  sim.setRegister(ACS37800_REGISTER_VOLATILE_2D, 0xFFFF1234);
+
+  MemoryStream stream;
+  ACS37800RecordEncoder encoder;
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.writeRecord(stream, encoder, 7));
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.writeRecord(stream, encoder, 7, ACS37800_RECORD_ALL));
+
+  ACS37800RecordDecoder decoder;
+  ACS37800_RECORD_t record;
+  uint8_t decoded = 0;
+  while (stream.available())
+  {
+    if (!decoder.decode((uint8_t)stream.read(), &record))
+      continue;
+    decoded++;
+    CHECK_EQUAL(7, record.deviceId);
+    CHECK_EQUAL(sim.getRegister(ACS37800_REGISTER_VOLATILE_20), record.reg20);
+    CHECK_EQUAL(sim.getRegister(ACS37800_REGISTER_VOLATILE_21), record.reg21);
+    CHECK_EQUAL(sim.getRegister(ACS37800_REGISTER_VOLATILE_22) & 0x1FFFFFFF, record.reg22);
+    if (decoded == 2)
+    {
+      CHECK_EQUAL(ACS37800_RECORD_ALL, record.contents);
+      CHECK_EQUAL(0x1234, record.reg2D);
+    }
+  }
+  CHECK_EQUAL(2, decoded);
+  sim.detach();
+}
+
+int main()
+{
+  RUN_TEST(testRoundTrip);
+  RUN_TEST(testCorruption);
+  RUN_TEST(testKeyInterval);
+  RUN_TEST(testWriteRecord);
+  return (TEST_RESULT());
+}
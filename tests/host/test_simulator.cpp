@@ -0,0 +1,312 @@
+/*
+  Host build of the SparkFun ACS37800 library : driver tests against the simulated ACS37800
+  Register access, access-code gating, EEPROM / shadow write latency, settle policies, the cache and the error paths
+*/
+
+#include "test_harness.h"
+
+//Register reads are one write transaction (the address) and one 4-byte read
+static void testRegisterAccess()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  ACS37800 sensor;
+  CHECK(sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire));
+
+  sim.setRegister(ACS37800_REGISTER_VOLATILE_2D, 0x12345678);
+  Wire.resetStatistics();
+  uint32_t data = 0;
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.readRegister(&data, ACS37800_REGISTER_VOLATILE_2D));
+  CHECK_EQUAL(0x12345678, data);
+  CHECK_EQUAL(1, Wire.getStatistics().writeTransactions);
+  CHECK_EQUAL(1, Wire.getStatistics().readTransactions);
+  CHECK_EQUAL(1, Wire.getStatistics().bytesWritten);
+  CHECK_EQUAL(4, Wire.getStatistics().bytesRead);
+
+  uint32_t registers[3];
+  sim.setRMS(1000, -200);
+  sim.setPower(-300, 400);
+  sim.setPowerFactor(500, -512, true, false);
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.readRegisters(registers, ACS37800_REGISTER_VOLATILE_20, 3));
+  CHECK_EQUAL(1000, ACS37800_FIELD_VRMS::extract(registers[0]));
+  CHECK_EQUAL(-200, ACS37800_FIELD_IRMS::extract(registers[0]));
+  CHECK_EQUAL(-300, ACS37800_FIELD_PACTIVE::extract(registers[1]));
+  CHECK_EQUAL(-512, ACS37800_FIELD_PFACTOR::extract(registers[2]));
+  sim.detach();
+}
+
+//The shadow and EEPROM registers ignore writes unless the customer access code has been written to 0x2F
+static void testAccessCode()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+
+  uint32_t before = sim.getRegister(ACS37800_REGISTER_SHADOW_1F);
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.writeRegister(before ^ 0x10, ACS37800_REGISTER_SHADOW_1F));
+  delay(50);
+  CHECK_EQUAL(before, sim.getRegister(ACS37800_REGISTER_SHADOW_1F));
+  CHECK_EQUAL(1, sim.getLockedWrites());
+
+  uint32_t status;
+  sensor.writeRegister(ACS37800_CUSTOMER_ACCESS_CODE, ACS37800_REGISTER_VOLATILE_2F);
+  sensor.readRegister(&status, ACS37800_REGISTER_VOLATILE_30);
+  CHECK_EQUAL(1, status);
+  sensor.writeRegister(0, ACS37800_REGISTER_VOLATILE_2F);
+  sensor.readRegister(&status, ACS37800_REGISTER_VOLATILE_30);
+  CHECK_EQUAL(0, status);
+
+  //The setters unlock, write and lock again
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setNumberOfSamples(100));
+  CHECK(!sim.isUnlocked());
+  uint32_t n = 0;
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.getNumberOfSamples(&n));
+  CHECK_EQUAL(100, n);
+  CHECK_EQUAL(1, sim.getLockedWrites());
+  sim.detach();
+}
+
+//A register reads as zero until its write latency has passed. The fixed delay always waits 100ms.
+//Polling the readback finishes as soon as the value appears
+static void testWriteLatency()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  sim.setWriteLatency(2000, 20000);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+
+  unsigned long start = millis();
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setNumberOfSamples(200, true));
+  CHECK(millis() - start >= ACS37800_SETTLE_TIME_MS);
+
+  sensor.setSettlePolicy(ACS37800_SETTLE_POLL_READBACK);
+  start = millis();
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setNumberOfSamples(300));
+  unsigned long shadowTime = millis() - start;
+  CHECK(shadowTime >= 2);
+  CHECK(shadowTime < 10);
+
+  start = millis();
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setNumberOfSamples(400, true));
+  unsigned long eepromTime = millis() - start;
+  CHECK(eepromTime >= 20);
+  CHECK(eepromTime < 30);
+  CHECK_EQUAL(400, ACS37800_FIELD_N::extract(sim.getRegister(ACS37800_REGISTER_EEPROM_0F)));
+
+  //Too slow
+  sim.setWriteLatency(2000, 200000);
+  CHECK_EQUAL(ACS37800_ERR_SETTLE_TIMEOUT, sensor.setNumberOfSamples(500, true));
+
+  //Not slow enough to matter for the fixed delay
+  delay(200);
+  sim.setWriteLatency(2000, 20000);
+  sensor.setSettlePolicy(ACS37800_SETTLE_FIXED_DELAY);
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setNumberOfSamples(600, true));
+  CHECK_EQUAL(600, ACS37800_FIELD_N::extract(sim.getRegister(ACS37800_REGISTER_EEPROM_0F)));
+  sim.detach();
+}
+
+//An EEPROM ECC error fails the settle. setI2Caddress takes effect at the next power cycle
+static void testI2CAddress()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+  sensor.setSettlePolicy(ACS37800_SETTLE_POLL_READBACK);
+
+  sim.setECCStatus(ACS37800_EEPROM_ECC_ERROR_UNCORRECTABLE);
+  CHECK(sensor.setI2Caddress(0x61) != ACS37800_SUCCESS);
+
+  sim.setECCStatus(ACS37800_EEPROM_ECC_NO_ERROR);
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setI2Caddress(0x61));
+  CHECK_EQUAL(0x60, sim.getAddress());
+  sim.powerCycle();
+  CHECK_EQUAL(0x61, sim.getAddress());
+
+  CHECK(!sensor.begin(0x60, Wire)); // Nothing there now
+  CHECK(sensor.begin(0x61, Wire));
+  sim.detach();
+}
+
+static uint32_t hookCalls;
+static uint8_t hookDetail;
+static void errorHook(ACS37800ERR error, uint8_t address, uint8_t detail, void *context)
+{
+  (void)error;
+  (void)address;
+  (void)context;
+  hookCalls++;
+  hookDetail = detail;
+}
+
+//Bus errors are returned and reported through the error hook
+static void testBusErrors()
+{
+  ACS37800 sensor;
+  CHECK(!sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire)); // No device attached
+
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  CHECK(sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire));
+  sensor.setErrorHook(errorHook);
+  hookCalls = 0;
+
+  uint32_t data;
+  Wire.failNext(1, 3);
+  CHECK_EQUAL(ACS37800_ERR_I2C_ERROR, sensor.readRegister(&data, ACS37800_REGISTER_VOLATILE_20));
+  CHECK_EQUAL(1, hookCalls);
+  CHECK_EQUAL(3, hookDetail);
+
+  float v, i;
+  Wire.failNext(1);
+  CHECK_EQUAL(ACS37800_ERR_I2C_ERROR, sensor.readRMS(&v, &i));
+  CHECK_EQUAL(2, hookCalls);
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.readRMS(&v, &i));
+  CHECK_EQUAL(2, hookCalls);
+  sim.detach();
+}
+
+//With the cache enabled, the getters and commitConfig do not re-read the shadow registers
+static void testRegisterCache()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+  sensor.setSettlePolicy(ACS37800_SETTLE_POLL_READBACK);
+  sensor.enableRegisterCache();
+
+  uint32_t n;
+  sensor.getNumberOfSamples(&n);
+  sim.resetCounts();
+  for (uint8_t i = 0; i < 10; i++)
+    sensor.getNumberOfSamples(&n);
+  CHECK_EQUAL(0, sim.getReads(ACS37800_REGISTER_SHADOW_1F));
+
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setBypassNenable(true));
+  bool bypass = false;
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.getBypassNenable(&bypass));
+  CHECK(bypass);
+  CHECK_EQUAL(1, sim.getWrites(ACS37800_REGISTER_SHADOW_1F));
+  sim.detach();
+}
+
+//The asynchronous setters complete through checkAsync, with the settle time measured by millis()
+static void testAsync()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.startSetNumberOfSamples(123));
+  CHECK_EQUAL(ACS37800_ERR_ASYNC_BUSY, sensor.startSetNumberOfSamples(124));
+  ACS37800_ASYNC_STATUS_e status;
+  uint16_t calls = 0;
+  while ((status = sensor.checkAsync()) == ACS37800_ASYNC_BUSY)
+  {
+    delay(1);
+    calls++;
+  }
+  CHECK_EQUAL(ACS37800_ASYNC_COMPLETE, status);
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.getAsyncResult());
+  CHECK(calls >= 50); // Other work can run during the settle time
+  CHECK_EQUAL(123, ACS37800_FIELD_N::extract(sim.getRegister(ACS37800_REGISTER_SHADOW_1F)));
+  sim.detach();
+}
+
+//A register written with all zero data bits reads the same as one still being written.
+//The blocking and asynchronous settles both accept it - but only once the fixed settle time has passed
+static void testSettleZero()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  sim.setWriteLatency(20000, 20000);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+  sensor.setSettlePolicy(ACS37800_SETTLE_POLL_READBACK, 50);
+
+  //N is the only non-zero field in 0x1F
+  unsigned long start = millis();
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setNumberOfSamples(0));
+  CHECK(millis() - start >= ACS37800_SETTLE_TIME_MS);
+  CHECK_EQUAL(0, sim.getRegister(ACS37800_REGISTER_SHADOW_1F));
+
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setNumberOfSamples(32));
+  start = millis();
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.startSetNumberOfSamples(0));
+  ACS37800_ASYNC_STATUS_e status;
+  while ((status = sensor.checkAsync()) == ACS37800_ASYNC_BUSY)
+    delay(1);
+  CHECK_EQUAL(ACS37800_ASYNC_COMPLETE, status);
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.getAsyncResult());
+  CHECK(millis() - start >= ACS37800_SETTLE_TIME_MS);
+  CHECK_EQUAL(0, sim.getRegister(ACS37800_REGISTER_SHADOW_1F));
+
+  //A zero field in a non-zero word settles as soon as the write completes, via either path
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setNumberOfSamples(32));
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setBypassNenable(true));
+  start = millis();
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setBypassNenable(false));
+  CHECK(millis() - start < ACS37800_SETTLE_TIME_MS);
+  CHECK_EQUAL(0, ACS37800_FIELD_BYPASS_N_EN::extract(sim.getRegister(ACS37800_REGISTER_SHADOW_1F)));
+
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.setBypassNenable(true));
+  start = millis();
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.startSetBypassNenable(false));
+  while ((status = sensor.checkAsync()) == ACS37800_ASYNC_BUSY)
+    delay(1);
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.getAsyncResult());
+  CHECK(millis() - start < ACS37800_SETTLE_TIME_MS);
+  CHECK_EQUAL(0, ACS37800_FIELD_BYPASS_N_EN::extract(sim.getRegister(ACS37800_REGISTER_SHADOW_1F)));
+  sim.detach();
+}
+
+//The float readers decode the simulated registers
+static void testReaders()
+{
+  ACS37800Simulator sim;
+  sim.attach(Wire);
+  ACS37800 sensor;
+  sensor.begin(ACS37800_DEFAULT_I2C_ADDRESS, Wire);
+  ACS37800_CALIBRATION_t calibration;
+  sensor.getCalibration(&calibration);
+
+  sim.setRMS(20000, -1000);
+  float v, i;
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.readRMS(&v, &i));
+  CHECK(fabsf(v - 20000 * calibration.voltsPerCodeRMS) < 1e-3f);
+  CHECK(fabsf(i + 1000 * calibration.ampsPerCodeRMS) < 1e-4f);
+
+  sim.setPowerFactor(3000, -1024, true, false);
+  float pApparent, pFactor;
+  bool posangle, pospf;
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.readPowerFactor(&pApparent, &pFactor, &posangle, &pospf));
+  CHECK(pFactor == -1.0f);
+  CHECK(posangle);
+  CHECK(!pospf);
+
+  sim.setInstantaneous(-5000, 6000, -7000);
+  float vInst, iInst, pInst;
+  CHECK_EQUAL(ACS37800_SUCCESS, sensor.readInstantaneous(&vInst, &iInst, &pInst));
+  CHECK(fabsf(vInst + 5000 * calibration.voltsPerCodeInst) < 1e-3f);
+  CHECK(fabsf(pInst + 7000 * calibration.wattsPerCode) < 1e-3f);
+  sim.detach();
+}
+
+int main()
+{
+  RUN_TEST(testRegisterAccess);
+  RUN_TEST(testAccessCode);
+  RUN_TEST(testWriteLatency);
+  RUN_TEST(testI2CAddress);
+  RUN_TEST(testBusErrors);
+  RUN_TEST(testRegisterCache);
+  RUN_TEST(testAsync);
+  RUN_TEST(testSettleZero);
+  RUN_TEST(testReaders);
+  return (TEST_RESULT());
+}